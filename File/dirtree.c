@@ -0,0 +1,480 @@
+/* File: dirtree.c */
+
+/* Version 2.0, Martin Titz, 2026 */
+
+/* Prints the tree of the directories below the given directories (default
+ * is the current directory), following symbolic links, e.g.
+ *
+ *     .
+ *     |-----a
+ *           |-----b
+ *     |-----c
+ *
+ * This replaces the shell script dirtree, which did the same with
+ * find -L | tr | sort -d | tr | sed. Instead of sorting all paths at the
+ * end, the entries of each directory are sorted on their own (in the
+ * dictionary order of sort -d), and the lines are written while walking
+ * the tree. Helper threads read the directories ahead of the walk, only
+ * a few per directory level, so memory grows with the depth of the tree
+ * and not with the number of its entries. Symbolic links leading back to
+ * a directory above are skipped like find -L does. */
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define DEFAULT_THREADS 8
+#define DENTS_SIZE      32768
+#define OUT_SIZE        1048576
+
+enum { NEW, QUEUED, READING, DONE };
+
+struct dir {
+    char *path;
+    size_t path_length;
+    dev_t dev;
+    ino_t ino;
+    int state;
+    int opened;
+    char *names;        /* names of the subdirectories, '\0' terminated */
+    char **sub;         /* the same, sorted */
+    size_t count;
+    struct dir *prev, *next;    /* queue of directories to read */
+};
+
+struct frame {
+    struct dir *dir;
+    struct dir **child;
+    size_t next;        /* next child to print */
+    size_t queued;      /* children up to here are created and queued */
+};
+
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static int threads = DEFAULT_THREADS;
+static size_t window;
+static int error_count = 0;
+static char out_buffer[OUT_SIZE];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static struct dir *queue_head = 0;
+static int stopping = 0;
+
+static struct frame *stack = 0;
+static size_t stack_size = 0;
+
+static char *line = 0;
+static size_t line_size = 0;
+
+static char *progname;
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: %s [-j threads] [directory]...\n", progname);
+}
+
+static void *xrealloc(void *p, size_t size)
+{
+    if ((p = realloc(p, size)) == NULL && size > 0) {
+        fprintf(stderr, "%s: out of memory\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* Order of sort -d in the C locale: only letters, digits and blanks are
+ * compared, names equal by this are ordered by all their bytes. */
+static int compare_names(const void *a, const void *b)
+{
+    const unsigned char *s = *(const unsigned char *const *) a;
+    const unsigned char *t = *(const unsigned char *const *) b;
+
+    for (;;) {
+        while (*s && !isalnum(*s) && !isblank(*s))
+            ++s;
+        while (*t && !isalnum(*t) && !isblank(*t))
+            ++t;
+        if (*s != *t)
+            return *s - *t;
+        if (*s == '\0')
+            return strcmp(*(char *const *) a, *(char *const *) b);
+        ++s;
+        ++t;
+    }
+}
+
+static struct dir *new_dir(const struct dir *parent, const char *name)
+{
+    struct dir *d = xrealloc(0, sizeof(*d));
+    size_t length = strlen(name);
+
+    memset(d, 0, sizeof(*d));
+    if (parent == NULL) {
+        d->path = xrealloc(0, length + 1);
+        memcpy(d->path, name, length + 1);
+        d->path_length = length;
+    } else {
+        size_t plength = parent->path_length;
+        int slash = plength > 0 && parent->path[plength-1] != '/';
+        d->path = xrealloc(0, plength + slash + length + 1);
+        memcpy(d->path, parent->path, plength);
+        if (slash)
+            d->path[plength] = '/';
+        memcpy(d->path + plength + slash, name, length + 1);
+        d->path_length = plength + slash + length;
+    }
+    return d;
+}
+
+static void free_dir(struct dir *d)
+{
+    free(d->path);
+    free(d->names);
+    free(d->sub);
+    free(d);
+}
+
+/* Reads the names of the subdirectories of d. The type in the directory
+ * entry saves the stat() call, except for symbolic links and file systems
+ * which don't fill it in. */
+static void read_dir(struct dir *d)
+{
+    char dents[DENTS_SIZE];
+    size_t used = 0, allocated = 0;
+    struct stat st;
+    long n;
+    int fd;
+
+    fd = openat(AT_FDCWD, d->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    if (fstat(fd, &st) == 0) {
+        d->dev = st.st_dev;
+        d->ino = st.st_ino;
+        d->opened = 1;
+    }
+    while ((n = syscall(SYS_getdents64, fd, dents, sizeof(dents))) > 0) {
+        long pos;
+        for (pos = 0; pos < n; ) {
+            struct linux_dirent64 *e = (struct linux_dirent64 *) (dents + pos);
+            const char *name = e->d_name;
+            size_t length;
+
+            pos += e->d_reclen;
+            if (name[0] == '.' && (name[1] == '\0' || name[1] == '.' && name[2] == '\0'))
+                continue;
+            if (e->d_type != DT_DIR) {
+                if (e->d_type != DT_LNK && e->d_type != DT_UNKNOWN)
+                    continue;
+                if (fstatat(fd, name, &st, 0) != 0 || !S_ISDIR(st.st_mode))
+                    continue;
+            }
+            length = strlen(name) + 1;
+            if (used + length > allocated) {
+                allocated = allocated ? 2 * allocated : 4096;
+                if (allocated < used + length)
+                    allocated = used + length;
+                d->names = xrealloc(d->names, allocated);
+            }
+            memcpy(d->names + used, name, length);
+            used += length;
+            ++d->count;
+        }
+    }
+    close(fd);
+
+    if (d->count > 0) {
+        size_t i, pos = 0;
+        d->sub = xrealloc(0, d->count * sizeof(*d->sub));
+        for (i = 0; i < d->count; ++i) {
+            d->sub[i] = d->names + pos;
+            pos += strlen(d->names + pos) + 1;
+        }
+        qsort(d->sub, d->count, sizeof(*d->sub), compare_names);
+    }
+}
+
+/* The queue is used as a stack, so the directories queued last, which
+ * belong to the deepest level of the walk, are read first. */
+static void enqueue(struct dir *d)
+{
+    d->state = QUEUED;
+    d->prev = 0;
+    d->next = queue_head;
+    if (queue_head)
+        queue_head->prev = d;
+    queue_head = d;
+}
+
+static void dequeue(struct dir *d)
+{
+    if (d->prev)
+        d->prev->next = d->next;
+    else
+        queue_head = d->next;
+    if (d->next)
+        d->next->prev = d->prev;
+}
+
+static void *reader(void *arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        struct dir *d;
+        while (queue_head == NULL && !stopping)
+            pthread_cond_wait(&work_cond, &lock);
+        if (stopping)
+            break;
+        d = queue_head;
+        dequeue(d);
+        d->state = READING;
+        pthread_mutex_unlock(&lock);
+        read_dir(d);
+        pthread_mutex_lock(&lock);
+        d->state = DONE;
+        pthread_cond_broadcast(&done_cond);
+    }
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/* Waits until d has been read, or reads it here if no thread has
+ * started with it yet. */
+static void wait_for(struct dir *d)
+{
+    pthread_mutex_lock(&lock);
+    if (d->state == NEW || d->state == QUEUED) {
+        if (d->state == QUEUED)
+            dequeue(d);
+        d->state = READING;
+        pthread_mutex_unlock(&lock);
+        read_dir(d);
+        pthread_mutex_lock(&lock);
+        d->state = DONE;
+    }
+    while (d->state != DONE)
+        pthread_cond_wait(&done_cond, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+/* Queues the next children of the frame, up to window of them ahead of
+ * the one printed next. */
+static void prefetch(struct frame *f)
+{
+    size_t limit = f->next + window;
+    int queued = 0;
+
+    if (limit > f->dir->count)
+        limit = f->dir->count;
+    if (f->queued >= limit)
+        return;
+    pthread_mutex_lock(&lock);
+    for (; f->queued < limit; ++f->queued) {
+        f->child[f->queued] = new_dir(f->dir, f->dir->sub[f->queued]);
+        if (threads > 0) {
+            enqueue(f->child[f->queued]);
+            queued = 1;
+        }
+    }
+    if (queued)
+        pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+/* Replaces every occurrence of from by to, which has the same length,
+ * going from left to right like s/from/to/g. */
+static void substitute(char *s, const char *from, const char *to)
+{
+    size_t length = strlen(from);
+    while ((s = strstr(s, from)) != NULL) {
+        memcpy(s, to, length);
+        s += length;
+    }
+}
+
+/* Writes the line for a path in the same way as the sed script of the
+ * former shell version. */
+static void print_line(const struct dir *d)
+{
+    const char *p = d->path, *slash;
+    size_t length = 0;
+
+    if (line_size < 6 * d->path_length + 2) {
+        line_size = 6 * d->path_length + 2;
+        line = xrealloc(line, line_size);
+    }
+    while ((slash = strchr(p, '/')) != NULL) {
+        memcpy(line + length, "|-----", 6);
+        length += 6;
+        p = slash + 1;
+    }
+    strcpy(line + length, p);
+    substitute(line, "|-----|", "      |");
+    substitute(line, " |----- ", "        ");
+    substitute(line, "|-----|", "      |");
+    substitute(line, " |----- ", "        ");
+    puts(line);
+}
+
+static int is_loop(const struct dir *d, size_t depth)
+{
+    size_t i;
+    for (i = 0; i < depth; ++i) {
+        if (stack[i].dir->dev == d->dev && stack[i].dir->ino == d->ino)
+            return 1;
+    }
+    return 0;
+}
+
+static void push(struct dir *d, size_t depth)
+{
+    if (depth >= stack_size) {
+        stack_size = stack_size ? 2 * stack_size : 64;
+        stack = xrealloc(stack, stack_size * sizeof(*stack));
+    }
+    stack[depth].dir = d;
+    stack[depth].child = d->count ? xrealloc(0, d->count * sizeof(struct dir *)) : 0;
+    stack[depth].next = 0;
+    stack[depth].queued = 0;
+}
+
+static void dirtree(const char *top)
+{
+    struct stat st;
+    struct dir *root;
+    size_t depth = 0;
+
+    if (stat(top, &st) != 0) {
+        fprintf(stderr, "%s: can't open %s (%s)\n", progname, top, strerror(errno));
+        ++error_count;
+        return;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return;
+    root = new_dir(0, top);
+    read_dir(root);
+    print_line(root);
+    push(root, depth++);
+
+    while (depth > 0) {
+        struct frame *f = &stack[depth-1];
+        struct dir *d;
+
+        if (f->next >= f->dir->count) {
+            free(f->child);
+            free_dir(f->dir);
+            --depth;
+            continue;
+        }
+        prefetch(f);
+        d = f->child[f->next++];
+        wait_for(d);
+        if (d->opened && is_loop(d, depth)) {
+            free_dir(d);
+            continue;
+        }
+        print_line(d);
+        push(d, depth++);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t *pool = 0;
+    int i, started = 0, dirs_done = 0;
+
+    progname = argv[0];
+#ifdef __unix__
+    {
+        char *ptmp;
+        if ((ptmp = strrchr(progname, '/')))
+            progname = ptmp + 1;
+    }
+#endif
+
+    for (--argc, ++argv; argc > 0 && **argv == '-' && (*argv)[1]; --argc, ++argv) {
+        if (strcmp(*argv, "--") == 0) {
+            --argc;
+            ++argv;
+            break;
+        }
+        while (*++*argv) {
+            switch (**argv) {
+              case 'h':
+              case '?':
+                usage();
+                return EXIT_SUCCESS;
+              case 'j':
+                if (*++*argv || --argc && *++argv) {
+                    threads = atoi(*argv);
+                } else {
+                    fprintf(stderr, "%s: option -j needs an argument.\n", progname);
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                goto nextarg;
+              default:
+                fprintf(stderr, "%s: unknown option -%c.\n", progname, **argv);
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+        nextarg: ;
+    }
+
+    if (threads < 0)
+        threads = 0;
+    window = threads > 0 ? 2 * threads : 1;
+    setvbuf(stdout, out_buffer, _IOFBF, OUT_SIZE);
+    if (threads > 0) {
+        pool = xrealloc(0, threads * sizeof(*pool));
+        for (started = 0; started < threads; ++started) {
+            if (pthread_create(&pool[started], 0, reader, 0) != 0)
+                break;
+        }
+        if (started == 0)
+            threads = 0;
+    }
+
+    for (; argc > 0; --argc, ++argv) {
+        dirtree(*argv);
+        ++dirs_done;
+    }
+    if (!dirs_done)
+        dirtree(".");
+
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&lock);
+    for (i = 0; i < started; ++i)
+        pthread_join(pool[i], 0);
+    free(pool);
+    free(stack);
+    free(line);
+
+    if (fflush(stdout) != 0) {
+        fprintf(stderr, "%s: write error (%s)\n", progname, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,494 @@
+/* File: extstat.c */
+
+/* Version 2.0, Martin Titz, 2013, 2014, 2019, 2025, 2026 */
+
+/* Statistics by file extensions, replaces ExtensionStatistics.pl with the
+ * same options and output:
+ *   -a  include files and directories starting with a dot
+ *   -f  list the extensions found for each file name without extension
+ *   -r  go through the directories recursively
+ *   -v  show the directories and skipped special files
+ *
+ * The directories are read with getdents64, and the type in the directory
+ * entries saves the stat() call for every entry where the file system
+ * provides it. Several threads (-j, default 8) take directories from a
+ * shared stack; each counts into its own hash tables, which are merged
+ * when all are done. Names are kept in arenas, each extension only once
+ * per thread. */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define NONE            "<noext>"       /* text for no extension */
+#define DEFAULT_THREADS 8
+#define DENTS_SIZE      32768
+#define ARENA_CHUNK     1048576
+#define TABLE_SIZE      1024            /* initial size, a power of two */
+
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct arena {
+    char *chunk;
+    size_t used, size;
+};
+
+/* Extension found for a basename, a list in the arena. */
+struct ext_node {
+    const char *ext;
+    struct ext_node *next;
+};
+
+struct entry {
+    const char *key;
+    size_t length;
+    uint64_t hash;
+    long count;                 /* files with this extension */
+    struct ext_node *exts;      /* extensions of this basename */
+    struct entry *next;
+};
+
+struct table {
+    struct entry **slot;
+    size_t size, used;
+};
+
+struct counter {
+    struct arena arena;
+    struct table extensions;
+    struct table basenames;
+};
+
+struct dir_job {
+    char *path;
+    struct dir_job *next;
+};
+
+static int all = 0;
+static int filename_statistics = 0;
+static int recursive = 0;
+static int verbose = 0;
+static int threads = DEFAULT_THREADS;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static struct dir_job *jobs = 0;
+static int busy = 0;
+
+static char *progname;
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [-a] [-f] [-r] [-v] [-j threads] file...\n", progname);
+}
+
+static void *xrealloc(void *p, size_t size)
+{
+    if ((p = realloc(p, size)) == NULL && size > 0) {
+        fprintf(stderr, "%s: out of memory\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void *arena_alloc(struct arena *a, size_t size)
+{
+    void *p;
+    size = (size + 7) & ~(size_t) 7;
+    if (a->used + size > a->size) {
+        /* the old chunk is not freed, the strings in it stay in use */
+        a->size = size > ARENA_CHUNK ? size : ARENA_CHUNK;
+        a->chunk = xrealloc(0, a->size);
+        a->used = 0;
+    }
+    p = a->chunk + a->used;
+    a->used += size;
+    return p;
+}
+
+static uint64_t hash_bytes(const char *s, size_t length)
+{
+    uint64_t h = 14695981039346656037ULL;
+    while (length-- > 0) {
+        h ^= (unsigned char) *s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void table_grow(struct table *t)
+{
+    size_t size = t->size ? 2 * t->size : TABLE_SIZE;
+    struct entry **slot = xrealloc(0, size * sizeof(*slot));
+    size_t i;
+
+    memset(slot, 0, size * sizeof(*slot));
+    for (i = 0; i < t->size; ++i) {
+        struct entry *e, *next;
+        for (e = t->slot[i]; e; e = next) {
+            next = e->next;
+            e->next = slot[e->hash & (size - 1)];
+            slot[e->hash & (size - 1)] = e;
+        }
+    }
+    free(t->slot);
+    t->slot = slot;
+    t->size = size;
+}
+
+/* Finds the entry for the key, or adds one. If copy is set the key is
+ * copied into the arena, else the pointer is kept. */
+static struct entry *intern(struct table *t, struct arena *a,
+                            const char *key, size_t length, uint64_t hash, int copy)
+{
+    struct entry *e;
+
+    if (t->size > 0) {
+        for (e = t->slot[hash & (t->size - 1)]; e; e = e->next) {
+            if (e->hash == hash && e->length == length
+                && memcmp(e->key, key, length) == 0)
+                return e;
+        }
+    }
+    if (t->used >= t->size / 2)
+        table_grow(t);
+    e = arena_alloc(a, sizeof(*e));
+    if (copy) {
+        char *s = arena_alloc(a, length + 1);
+        memcpy(s, key, length);
+        s[length] = '\0';
+        key = s;
+    }
+    e->key = key;
+    e->length = length;
+    e->hash = hash;
+    e->count = 0;
+    e->exts = 0;
+    e->next = t->slot[hash & (t->size - 1)];
+    t->slot[hash & (t->size - 1)] = e;
+    ++t->used;
+    return e;
+}
+
+static void process_filename(struct counter *c, const char *filename)
+{
+    const char *dot = strrchr(filename, '.');
+    size_t length = strlen(filename);
+    const char *ext = dot ? dot + 1 : filename + length;
+    size_t ext_length = filename + length - ext;
+    struct entry *e;
+
+    if (ext_length == 0)
+        e = intern(&c->extensions, &c->arena, NONE, strlen(NONE), hash_bytes(NONE, strlen(NONE)), 0);
+    else
+        e = intern(&c->extensions, &c->arena, ext, ext_length, hash_bytes(ext, ext_length), 1);
+    ++e->count;
+    if (filename_statistics) {
+        size_t base_length = dot ? (size_t)(dot - filename) : length;
+        struct entry *b = intern(&c->basenames, &c->arena, filename, base_length,
+                                 hash_bytes(filename, base_length), 1);
+        struct ext_node *n = arena_alloc(&c->arena, sizeof(*n));
+        n->ext = ext_length == 0 ? "" : e->key;
+        n->next = b->exts;
+        b->exts = n;
+    }
+}
+
+static void push_dir(char *path)
+{
+    struct dir_job *j = xrealloc(0, sizeof(*j));
+    j->path = path;
+    pthread_mutex_lock(&lock);
+    j->next = jobs;
+    jobs = j;
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+static void process_directory(struct counter *c, const char *dir)
+{
+    char dents[DENTS_SIZE];
+    size_t dir_length = strlen(dir);
+    char *filename = 0;
+    size_t filename_size = 0;
+    long n;
+    int fd;
+
+    if (verbose)
+        printf("Processing directory %s\n", dir);
+    if ((fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+        fprintf(stderr, "Cannot open directory %s: %s\n", dir, strerror(errno));
+        return;
+    }
+    while ((n = syscall(SYS_getdents64, fd, dents, sizeof(dents))) > 0) {
+        long pos;
+        for (pos = 0; pos < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *) (dents + pos);
+            const char *name = d->d_name;
+            size_t length = strlen(name);
+            int type = d->d_type;
+
+            pos += d->d_reclen;
+            if (name[0] == '.' && (name[1] == '\0' || name[1] == '.' && name[2] == '\0'))
+                continue;
+            if (name[0] == '.' && !all)
+                continue;
+            if (type == DT_LNK || type == DT_UNKNOWN) {
+                struct stat st;
+                if (fstatat(fd, name, &st, 0) != 0)
+                    type = DT_UNKNOWN;
+                else if (S_ISDIR(st.st_mode))
+                    type = DT_DIR;
+                else if (S_ISREG(st.st_mode))
+                    type = DT_REG;
+                else
+                    type = DT_UNKNOWN;
+            }
+            if (type == DT_REG) {
+                process_filename(c, name);
+                continue;
+            }
+            if (type == DT_DIR && !recursive)
+                continue;
+            if (dir_length + length + 2 > filename_size) {
+                filename_size = 2 * (dir_length + length + 2);
+                filename = xrealloc(filename, filename_size);
+            }
+            memcpy(filename, dir, dir_length);
+            filename[dir_length] = '/';
+            memcpy(filename + dir_length + 1, name, length + 1);
+            if (type == DT_DIR) {
+                push_dir(filename);
+                filename = 0;
+                filename_size = 0;
+            } else if (verbose) {
+                printf("  Ignoring special file %s\n", filename);
+            }
+        }
+    }
+    close(fd);
+    free(filename);
+}
+
+/* Takes directories from the stack until it is empty and no other
+ * thread is still reading a directory, which could add more. */
+static void *worker(void *arg)
+{
+    struct counter *c = arg;
+
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        struct dir_job *j;
+        while (jobs == NULL && busy > 0)
+            pthread_cond_wait(&work_cond, &lock);
+        if (jobs == NULL)
+            break;
+        j = jobs;
+        jobs = j->next;
+        ++busy;
+        pthread_mutex_unlock(&lock);
+        process_directory(c, j->path);
+        free(j->path);
+        free(j);
+        pthread_mutex_lock(&lock);
+        if (--busy == 0 && jobs == NULL)
+            pthread_cond_broadcast(&work_cond);
+    }
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/* Goes through the directories on the stack with all threads, each
+ * counting into its own element of counters. */
+static void run_workers(struct counter *counters)
+{
+    pthread_t *pool = xrealloc(0, threads * sizeof(*pool));
+    int i, started;
+
+    for (started = 1; started < threads; ++started) {
+        if (pthread_create(&pool[started], 0, worker, &counters[started]) != 0)
+            break;
+    }
+    worker(&counters[0]);
+    for (i = 1; i < started; ++i)
+        pthread_join(pool[i], 0);
+    free(pool);
+}
+
+/* Adds the tables of c to those of total. The keys and lists stay in the
+ * arena of c. */
+static void merge(struct counter *total, struct counter *c)
+{
+    size_t i;
+    for (i = 0; i < c->extensions.size; ++i) {
+        struct entry *e;
+        for (e = c->extensions.slot[i]; e; e = e->next)
+            intern(&total->extensions, &total->arena, e->key, e->length, e->hash, 0)->count += e->count;
+    }
+    for (i = 0; i < c->basenames.size; ++i) {
+        struct entry *e;
+        for (e = c->basenames.slot[i]; e; e = e->next) {
+            struct entry *b = intern(&total->basenames, &total->arena,
+                                     e->key, e->length, e->hash, 0);
+            struct ext_node *n = e->exts;
+            while (n->next)
+                n = n->next;
+            n->next = b->exts;
+            b->exts = e->exts;
+        }
+    }
+}
+
+/* Order of byExtensions: NONE first, the rest as by strcmp(). */
+static int by_extensions(const void *a, const void *b)
+{
+    const char *s = (*(struct entry *const *) a)->key;
+    const char *t = (*(struct entry *const *) b)->key;
+    int s_none = strcmp(s, NONE) == 0, t_none = strcmp(t, NONE) == 0;
+
+    if (s_none || t_none)
+        return t_none - s_none;
+    return strcmp(s, t);
+}
+
+static int by_string(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+static struct entry **sorted_entries(const struct table *t)
+{
+    struct entry **list = xrealloc(0, (t->used + 1) * sizeof(*list));
+    size_t i, n = 0;
+
+    for (i = 0; i < t->size; ++i) {
+        struct entry *e;
+        for (e = t->slot[i]; e; e = e->next)
+            list[n++] = e;
+    }
+    qsort(list, n, sizeof(*list), by_extensions);
+    return list;
+}
+
+static void process_final(struct counter *total)
+{
+    struct entry **list = sorted_entries(&total->extensions);
+    size_t i;
+
+    for (i = 0; i < total->extensions.used; ++i)
+        printf("%-12s%8ld\n", list[i]->key, list[i]->count);
+    free(list);
+
+    if (filename_statistics) {
+        const char **exts = 0;
+        size_t exts_size = 0;
+
+        putchar('\n');
+        list = sorted_entries(&total->basenames);
+        for (i = 0; i < total->basenames.used; ++i) {
+            struct ext_node *node;
+            size_t k, n = 0;
+
+            for (node = list[i]->exts; node; node = node->next) {
+                if (n >= exts_size) {
+                    exts_size = exts_size ? 2 * exts_size : 16;
+                    exts = xrealloc(exts, exts_size * sizeof(*exts));
+                }
+                exts[n++] = node->ext;
+            }
+            qsort(exts, n, sizeof(*exts), by_string);
+            fputs(list[i]->key, stdout);
+            for (k = 0; k < n; ++k) {
+                putchar(' ');
+                fputs(exts[k][0] ? exts[k] : NONE, stdout);
+            }
+            putchar('\n');
+        }
+        free(exts);
+        free(list);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct counter total, *counters;
+    struct stat st;
+    int i;
+
+    progname = argv[0];
+#ifdef __unix__
+    {
+        char *ptmp;
+        if ((ptmp = strrchr(progname, '/')))
+            progname = ptmp + 1;
+    }
+#endif
+
+    for (--argc, ++argv; argc > 0 && **argv == '-'; --argc, ++argv) {
+        if (strcmp(*argv, "-a") == 0) {
+            all = 1;
+        } else if (strcmp(*argv, "-h") == 0) {
+            usage();
+            return EXIT_SUCCESS;
+        } else if (strcmp(*argv, "-f") == 0) {
+            filename_statistics = 1;
+        } else if (strcmp(*argv, "-r") == 0) {
+            recursive = 1;
+        } else if (strcmp(*argv, "-v") == 0) {
+            verbose = 1;
+        } else if (strncmp(*argv, "-j", 2) == 0) {
+            if ((*argv)[2]) {
+                threads = atoi(*argv + 2);
+            } else if (--argc > 0) {
+                threads = atoi(*++argv);
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+        } else {
+            fprintf(stderr, "Unrecognized switch: %s\n", *argv);
+            return EXIT_FAILURE;
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+
+    memset(&total, 0, sizeof(total));
+    counters = xrealloc(0, threads * sizeof(*counters));
+    memset(counters, 0, threads * sizeof(*counters));
+    for (i = 0; i < (argc > 0 ? argc : 1); ++i) {
+        const char *arg = argc > 0 ? argv[i] : ".";
+        if (stat(arg, &st) == 0 && S_ISREG(st.st_mode)) {
+            process_filename(&total, arg);
+        } else if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+            char *path = xrealloc(0, strlen(arg) + 1);
+            push_dir(strcpy(path, arg));
+            run_workers(counters);
+        } else {
+            printf("%s does not exist.\n", arg);
+        }
+    }
+    for (i = 0; i < threads; ++i)
+        merge(&total, &counters[i]);
+
+    if (verbose)
+        putchar('\n');
+    process_final(&total);
+    return EXIT_SUCCESS;
+}
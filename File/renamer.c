@@ -0,0 +1,760 @@
+/* File: renamer.c */
+
+/* Version 2.0, Martin Titz, 1997, 2023, 2026 */
+
+/* Bulk renaming of files, installed under the names of the former Perl
+ * scripts it replaces:
+ *
+ *   renumber [-n] [-nr] [-r] [-v] [-j threads] [dirpart] file_begin file_end digits
+ *     Renames files with numbers in their names, so that all numbers have
+ *     the same length including leading zeros. file_begin and file_end
+ *     are extended regular expressions, \d may be used for a digit.
+ *
+ *   utol [-n] [-v] [-j threads] file...
+ *     Converts the names of files from uppercase to lowercase, reads the
+ *     names from stdin if none are given.
+ *
+ * All renames of a directory are planned before the first one is done:
+ * the entries are read with getdents64 into a hash table, and a rename is
+ * refused if its new name is taken by a file which stays, or by another
+ * rename. Renames whose new name is the old name of another one are done
+ * in the right order, and cycles like a -> b, b -> a go through a
+ * temporary name. Each rename uses RENAME_NOREPLACE, so files created
+ * meanwhile are never overwritten. Directories are handled in parallel.
+ * With -n the planned renames are only printed. */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <regex.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define DEFAULT_THREADS 8
+#define DENTS_SIZE      32768
+
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Hash table of names, open addressing, values are indices. */
+struct slot {
+    const char *key;
+    uint64_t hash;
+    long value;
+};
+
+struct table {
+    struct slot *slot;
+    size_t size;
+};
+
+struct entry {
+    char *name;
+    int regular;
+    long source;        /* rename of this entry, or -1 */
+};
+
+struct rename {
+    long from;          /* entry */
+    char *old_name;     /* the entry name, or a temporary name */
+    char *new_name;
+    long arg;           /* utol: index in the names of the job */
+    int valid;
+    int done;
+    int state;          /* 0 to do, 1 in progress, 2 done */
+    long blocker;       /* rename of the entry with the new name, or -1 */
+    long blocked;       /* rename waiting for this one, or -1 */
+};
+
+struct job {
+    char *dir;
+    char **names;       /* utol: names to rename in dir */
+    char **given;       /* utol: the same as given on the command line */
+    size_t name_count, name_size;
+    int depth;
+    struct job *next;
+};
+
+static int utol_mode = 0;
+static int just_print = 0;
+static int recursive = 1;
+static int verbose = 0;
+static int threads = DEFAULT_THREADS;
+static regex_t pattern;
+static int digits;
+
+static long dirs = 0, files = 0, matches = 0, changes = 0;
+static int error_count = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static struct job *jobs = 0;
+static int busy = 0;
+static long temp_counter = 0;
+
+static char *progname;
+
+static void usage(void)
+{
+    if (utol_mode)
+        fprintf(stderr, "Usage: %s [-n] [-v] [-j threads] file...\n", progname);
+    else
+        fprintf(stderr, "Usage: %s [-n] [-nr] [-r] [-v] [-j threads] "
+                        "[dirpart] file_begin file_end digits\n", progname);
+}
+
+static void *xrealloc(void *p, size_t size)
+{
+    if ((p = realloc(p, size)) == NULL && size > 0) {
+        fprintf(stderr, "%s: out of memory\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static char *xstrdup(const char *s)
+{
+    return strcpy(xrealloc(0, strlen(s) + 1), s);
+}
+
+static uint64_t hash_string(const char *s)
+{
+    uint64_t h = 14695981039346656037ULL;
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void table_init(struct table *t, size_t count)
+{
+    t->size = 16;
+    while (t->size < 2 * count)
+        t->size *= 2;
+    t->slot = xrealloc(0, t->size * sizeof(*t->slot));
+    memset(t->slot, 0, t->size * sizeof(*t->slot));
+}
+
+/* Returns the slot of key, which is empty if the key is not there. */
+static struct slot *table_find(const struct table *t, const char *key)
+{
+    uint64_t hash = hash_string(key);
+    size_t i = hash & (t->size - 1);
+
+    while (t->slot[i].key != NULL) {
+        if (t->slot[i].hash == hash && strcmp(t->slot[i].key, key) == 0)
+            break;
+        i = (i + 1) & (t->size - 1);
+    }
+    t->slot[i].hash = hash;
+    return &t->slot[i];
+}
+
+/* New name of a file for renumber, or NULL if the name doesn't match. */
+static char *renumbered(const char *name)
+{
+    regmatch_t m[4];
+    const char *num;
+    size_t length, pad;
+    char *s;
+
+    if (regexec(&pattern, name, 4, m, 0) != 0)
+        return NULL;
+    num = name + m[2].rm_so;
+    length = m[2].rm_eo - m[2].rm_so;
+    while (length > 1 && *num == '0') {
+        ++num;
+        --length;
+    }
+    pad = length < (size_t) digits ? digits - length : 0;
+    s = xrealloc(0, strlen(name) + pad + 1);
+    memcpy(s, name, m[2].rm_so);
+    memset(s + m[2].rm_so, '0', pad);
+    memcpy(s + m[2].rm_so + pad, num, length);
+    strcpy(s + m[2].rm_so + pad + length, name + m[2].rm_eo);
+    return s;
+}
+
+static char *lowercase(const char *name)
+{
+    char *s = xstrdup(name), *p;
+    for (p = s; *p; ++p) {
+        if (*p >= 'A' && *p <= 'Z')
+            *p += 'a' - 'A';
+    }
+    return s;
+}
+
+static char *path_of(const char *dir, const char *name)
+{
+    size_t length = strlen(dir);
+    char *s = xrealloc(0, length + strlen(name) + 2);
+    memcpy(s, dir, length);
+    s[length] = '/';
+    strcpy(s + length + 1, name);
+    return s;
+}
+
+static void push_job(struct job *j)
+{
+    pthread_mutex_lock(&lock);
+    j->next = jobs;
+    jobs = j;
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+static void free_job(struct job *j)
+{
+    size_t i;
+    for (i = 0; i < j->name_count; ++i) {
+        free(j->names[i]);
+        free(j->given[i]);
+    }
+    free(j->names);
+    free(j->given);
+    free(j->dir);
+    free(j);
+}
+
+/* Renames r, after the rename which frees its new name. A cycle is broken
+ * by moving the old name of the rename found in progress out of the way. */
+static void do_rename(int fd, struct rename *renames, long r, const char *dir,
+                      int *errors)
+{
+    struct rename *p = &renames[r];
+    long b = p->blocker;
+
+    p->state = 1;
+    if (b >= 0 && renames[b].state == 0) {
+        do_rename(fd, renames, b, dir, errors);
+    } else if (b >= 0 && renames[b].state == 1) {
+        char temp[64];
+        for (;;) {
+            pthread_mutex_lock(&lock);
+            snprintf(temp, sizeof(temp), ".%s.%ld.%ld", progname,
+                     (long) getpid(), ++temp_counter);
+            pthread_mutex_unlock(&lock);
+            if (renameat2(fd, renames[b].old_name, fd, temp, RENAME_NOREPLACE) == 0)
+                break;
+            if (errno != EEXIST) {
+                fprintf(stderr, "%s: Can't rename %s/%s: %s\n", progname, dir,
+                        renames[b].old_name, strerror(errno));
+                ++*errors;
+                p->state = 2;
+                return;
+            }
+        }
+        renames[b].old_name = xstrdup(temp);
+    }
+    p->state = 2;
+    if (renameat2(fd, p->old_name, fd, p->new_name, RENAME_NOREPLACE) == 0) {
+        p->done = 1;
+    } else {
+        fprintf(stderr, "%s: Can't rename %s/%s to %s/%s: %s\n", progname, dir,
+                p->old_name, dir, p->new_name, strerror(errno));
+        ++*errors;
+    }
+}
+
+static void process_job(struct job *j)
+{
+    char dents[DENTS_SIZE];
+    struct entry *entries = 0;
+    struct rename *renames = 0;
+    size_t entry_count = 0, entry_size = 0, rename_count = 0, i;
+    long n, job_files = 0, job_matches = 0, job_changes = 0;
+    int job_errors = 0;
+    struct table names, targets;
+    char *text = 0;
+    size_t text_length = 0;
+    FILE *out;
+    int fd;
+
+    if ((fd = open(j->dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+        if (utol_mode)
+            for (i = 0; i < j->name_count; ++i)
+                fprintf(stderr, "%s: File %s doesn't exist\n", progname, j->given[i]);
+        else
+            fprintf(stderr, "%s: Cannot open directory %s: %s\n",
+                    progname, j->dir, strerror(errno));
+        pthread_mutex_lock(&lock);
+        ++error_count;
+        pthread_mutex_unlock(&lock);
+        free_job(j);
+        return;
+    }
+    if ((out = open_memstream(&text, &text_length)) == NULL) {
+        fprintf(stderr, "%s: out of memory\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    if (verbose && !utol_mode)
+        fprintf(out, "Processing directory %s\n", j->dir);
+
+    /* read all entries of the directory */
+    while ((n = syscall(SYS_getdents64, fd, dents, sizeof(dents))) > 0) {
+        long pos;
+        for (pos = 0; pos < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *) (dents + pos);
+            const char *name = d->d_name;
+            int type = d->d_type;
+
+            pos += d->d_reclen;
+            if (name[0] == '.' && (name[1] == '\0' || name[1] == '.' && name[2] == '\0'))
+                continue;
+            if (!utol_mode && (type == DT_LNK || type == DT_UNKNOWN)) {
+                struct stat st;
+                if (fstatat(fd, name, &st, 0) != 0)
+                    type = DT_UNKNOWN;
+                else if (S_ISDIR(st.st_mode))
+                    type = DT_DIR;
+                else if (S_ISREG(st.st_mode))
+                    type = DT_REG;
+            }
+            if (!utol_mode && recursive && type == DT_DIR) {
+                struct job *sub = xrealloc(0, sizeof(*sub));
+                memset(sub, 0, sizeof(*sub));
+                sub->dir = path_of(j->dir, name);
+                push_job(sub);
+            }
+            if (entry_count >= entry_size) {
+                entry_size = entry_size ? 2 * entry_size : 1024;
+                entries = xrealloc(entries, entry_size * sizeof(*entries));
+            }
+            entries[entry_count].name = xstrdup(name);
+            entries[entry_count].regular = type == DT_REG;
+            entries[entry_count].source = -1;
+            ++entry_count;
+        }
+    }
+    table_init(&names, entry_count);
+    for (i = 0; i < entry_count; ++i) {
+        struct slot *s = table_find(&names, entries[i].name);
+        s->key = entries[i].name;
+        s->value = i;
+    }
+
+    /* plan the renames */
+    renames = xrealloc(0, (utol_mode ? j->name_count : entry_count) * sizeof(*renames) + 1);
+    if (utol_mode) {
+        for (i = 0; i < j->name_count; ++i) {
+            struct slot *s = table_find(&names, j->names[i]);
+            char *new_name;
+            if (s->key == NULL) {
+                fprintf(stderr, "%s: File %s doesn't exist\n", progname, j->given[i]);
+                ++job_errors;
+                continue;
+            }
+            new_name = lowercase(j->names[i]);
+            if (strcmp(new_name, j->names[i]) == 0 || entries[s->value].source >= 0) {
+                free(new_name);
+                continue;
+            }
+            entries[s->value].source = rename_count;
+            renames[rename_count].from = s->value;
+            renames[rename_count].arg = i;
+            renames[rename_count++].new_name = new_name;
+        }
+    } else {
+        for (i = 0; i < entry_count; ++i) {
+            char *new_name;
+            if (!entries[i].regular)
+                continue;
+            ++job_files;
+            if ((new_name = renumbered(entries[i].name)) == NULL)
+                continue;
+            ++job_matches;
+            if (strcmp(new_name, entries[i].name) == 0) {
+                free(new_name);
+                continue;
+            }
+            entries[i].source = rename_count;
+            renames[rename_count].from = i;
+            renames[rename_count++].new_name = new_name;
+        }
+    }
+
+    /* a new name must be free, or be the old name of a rename done before */
+    table_init(&targets, rename_count);
+    for (i = 0; i < rename_count; ++i) {
+        struct rename *r = &renames[i];
+        struct slot *s = table_find(&targets, r->new_name);
+        r->old_name = entries[r->from].name;
+        r->valid = s->key == NULL;
+        r->done = 0;
+        r->state = 0;
+        r->blocker = r->blocked = -1;
+        if (r->valid) {
+            s->key = r->new_name;
+            s->value = i;
+        }
+    }
+    for (i = 0; i < rename_count; ++i) {
+        struct rename *r = &renames[i];
+        struct slot *s = table_find(&names, r->new_name);
+        if (s->key == NULL || !r->valid)
+            continue;
+        if (entries[s->value].source < 0) {
+            r->valid = 0;
+        } else {
+            r->blocker = entries[s->value].source;
+            renames[r->blocker].blocked = i;
+        }
+    }
+    for (i = 0; i < rename_count; ++i) {
+        long k;
+        if (renames[i].valid)
+            continue;
+        for (k = renames[i].blocked; k >= 0 && renames[k].valid; k = renames[k].blocked)
+            renames[k].valid = 0;
+    }
+
+    if (!just_print) {
+        for (i = 0; i < rename_count; ++i) {
+            if (renames[i].valid && renames[i].state == 0)
+                do_rename(fd, renames, i, j->dir, &job_errors);
+        }
+    }
+    close(fd);
+
+    for (i = 0; i < rename_count; ++i) {
+        struct rename *r = &renames[i];
+        const char *name = entries[r->from].name;
+        char *old_path, *new_path;
+
+        if (utol_mode) {
+            size_t length = strlen(j->given[r->arg]) - strlen(name);
+            old_path = xstrdup(j->given[r->arg]);
+            new_path = xrealloc(0, length + strlen(r->new_name) + 1);
+            memcpy(new_path, old_path, length);
+            strcpy(new_path + length, r->new_name);
+        } else {
+            old_path = path_of(j->dir, name);
+            new_path = path_of(j->dir, r->new_name);
+        }
+        if (!r->valid) {
+            fprintf(stderr, "%s: File %s already exists, can't rename %s\n",
+                    progname, new_path, old_path);
+            ++job_errors;
+        } else if (just_print || r->done) {
+            if (just_print || verbose)
+                fprintf(out, utol_mode ? "Renaming %s -> %s\n" : "  %s -> %s\n",
+                        old_path, new_path);
+            ++job_changes;
+        }
+        free(old_path);
+        free(new_path);
+    }
+
+    fclose(out);
+    pthread_mutex_lock(&lock);
+    fputs(text, stdout);
+    if (!utol_mode)
+        ++dirs;
+    files += job_files;
+    matches += job_matches;
+    changes += job_changes;
+    error_count += job_errors;
+    pthread_mutex_unlock(&lock);
+    free(text);
+
+    for (i = 0; i < rename_count; ++i) {
+        if (renames[i].old_name != entries[renames[i].from].name)
+            free(renames[i].old_name);
+        free(renames[i].new_name);
+    }
+    for (i = 0; i < entry_count; ++i)
+        free(entries[i].name);
+    free(entries);
+    free(renames);
+    free(names.slot);
+    free(targets.slot);
+    free_job(j);
+}
+
+static void *worker(void *arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        struct job *j;
+        while (jobs == NULL && busy > 0)
+            pthread_cond_wait(&work_cond, &lock);
+        if (jobs == NULL)
+            break;
+        j = jobs;
+        jobs = j->next;
+        ++busy;
+        pthread_mutex_unlock(&lock);
+        process_job(j);
+        pthread_mutex_lock(&lock);
+        if (--busy == 0 && jobs == NULL)
+            pthread_cond_broadcast(&work_cond);
+    }
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+static void run_workers(void)
+{
+    pthread_t *pool = xrealloc(0, threads * sizeof(*pool));
+    int i, started;
+
+    for (started = 1; started < threads; ++started) {
+        if (pthread_create(&pool[started], 0, worker, 0) != 0)
+            break;
+    }
+    worker(0);
+    for (i = 1; i < started; ++i)
+        pthread_join(pool[i], 0);
+    free(pool);
+}
+
+/* Translates \d, which Perl patterns of the former script used, for
+ * regcomp(), and anchors the pattern like /^(begin)(\d+)(end)$/. */
+static void compile_pattern(const char *begin, const char *end)
+{
+    const char *part[2];
+    char *s, *p, message[256];
+    int i, result;
+
+    part[0] = begin;
+    part[1] = end;
+    s = p = xrealloc(0, 5 * (strlen(begin) + strlen(end)) + 32);
+    *p++ = '^';
+    for (i = 0; i < 2; ++i) {
+        const char *q;
+        *p++ = '(';
+        for (q = part[i]; *q; ++q) {
+            if (q[0] == '\\' && q[1] == 'd') {
+                strcpy(p, "[0-9]");
+                p += 5;
+                ++q;
+            } else {
+                if (q[0] == '\\' && q[1])
+                    *p++ = *q++;
+                *p++ = *q;
+            }
+        }
+        *p++ = ')';
+        if (i == 0) {
+            strcpy(p, "([0-9]+)");
+            p += 8;
+        }
+    }
+    strcpy(p, "$");
+    if ((result = regcomp(&pattern, s, REG_EXTENDED)) != 0) {
+        regerror(result, &pattern, message, sizeof(message));
+        fprintf(stderr, "%s: %s in %s\n", progname, message, s);
+        exit(EXIT_FAILURE);
+    }
+    free(s);
+}
+
+/* Sorts the files for utol into jobs by directory. */
+static int by_dir(const void *a, const void *b)
+{
+    const char *s = *(const char *const *) a, *t = *(const char *const *) b;
+    const char *ss = strrchr(s, '/'), *ts = strrchr(t, '/');
+    size_t sl = ss ? (size_t)(ss - s) : 0, tl = ts ? (size_t)(ts - t) : 0;
+    int c = memcmp(s, t, sl < tl ? sl : tl);
+    return c ? c : sl < tl ? -1 : sl > tl;
+}
+
+static void add_file(struct job **last, const char *given, int *max_depth)
+{
+    char *file = xstrdup(given), *slash;
+    const char *dir;
+    struct job *j = *last;
+    size_t length = strlen(file);
+
+    while (length > 1 && file[length-1] == '/')
+        file[--length] = '\0';
+    slash = strrchr(file, '/');
+    if (slash == file) {
+        dir = "/";
+    } else if (slash) {
+        *slash = '\0';
+        dir = file;
+    } else {
+        dir = ".";
+    }
+    if (j == NULL || strcmp(j->dir, dir) != 0) {
+        const char *p;
+        j = xrealloc(0, sizeof(*j));
+        memset(j, 0, sizeof(*j));
+        j->dir = xstrdup(dir);
+        if (strcmp(dir, ".") != 0) {
+            j->depth = 1;
+            for (p = j->dir; *p; ++p)
+                j->depth += *p == '/';
+        }
+        if (j->depth > *max_depth)
+            *max_depth = j->depth;
+        j->next = *last;
+        *last = j;
+    }
+    if (j->name_count >= j->name_size) {
+        j->name_size = j->name_size ? 2 * j->name_size : 16;
+        j->names = xrealloc(j->names, j->name_size * sizeof(*j->names));
+        j->given = xrealloc(j->given, j->name_size * sizeof(*j->given));
+    }
+    j->names[j->name_count] = xstrdup(slash ? slash + 1 : file);
+    j->given[j->name_count++] = xstrdup(given);
+    free(file);
+}
+
+/* The files of one directory level are renamed in parallel, the deepest
+ * level first, so a directory is only renamed after the files in it. */
+static void utol(int argc, char *argv[])
+{
+    char **list = 0, *line = 0;
+    size_t count = 0, size = 0, line_size = 0, i;
+    struct job *all = 0, *j, *next;
+    int depth, max_depth = 0;
+    ssize_t length;
+
+    if (argc > 0) {
+        list = xrealloc(0, argc * sizeof(*list));
+        for (count = 0; count < (size_t) argc; ++count)
+            list[count] = xstrdup(argv[count]);
+    } else {
+        while ((length = getline(&line, &line_size, stdin)) > 0) {
+            if (line[length-1] == '\n')
+                line[--length] = '\0';
+            if (count >= size) {
+                size = size ? 2 * size : 1024;
+                list = xrealloc(list, size * sizeof(*list));
+            }
+            list[count++] = xstrdup(line);
+        }
+        free(line);
+    }
+    qsort(list, count, sizeof(*list), by_dir);
+    for (i = 0; i < count; ++i) {
+        add_file(&all, list[i], &max_depth);
+        free(list[i]);
+    }
+    free(list);
+
+    for (depth = max_depth; depth >= 0; --depth) {
+        for (j = all, all = 0; j; j = next) {
+            next = j->next;
+            if (j->depth == depth) {
+                push_job(j);
+            } else {
+                j->next = all;
+                all = j;
+            }
+        }
+        run_workers();
+    }
+}
+
+static void renumber(int argc, char *argv[])
+{
+    struct job *j;
+    struct stat st;
+    char *dirbase = ".";
+    size_t length;
+
+    if (argc < 3 || argc > 4) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 4) {
+        dirbase = *argv++;
+        length = strlen(dirbase);
+        if (length > 1 && dirbase[length-1] == '/')
+            dirbase[length-1] = '\0';
+    }
+    if (stat(dirbase, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Missing directory: %s\n", dirbase);
+        exit(EXIT_FAILURE);
+    }
+    if (strspn(argv[2] + (argv[2][0] == '+'), "0123456789") != strlen(argv[2] + (argv[2][0] == '+'))
+        || (digits = atoi(argv[2])) <= 0) {
+        fprintf(stderr, "Last argument must be a positive integer.\n");
+        exit(EXIT_FAILURE);
+    }
+    compile_pattern(argv[0], argv[1]);
+
+    j = xrealloc(0, sizeof(*j));
+    memset(j, 0, sizeof(*j));
+    j->dir = xstrdup(dirbase);
+    push_job(j);
+    run_workers();
+
+    if (verbose)
+        putchar('\n');
+    printf("Processed directories:%8ld\n", dirs);
+    printf("Processed files:      %8ld\n", files);
+    printf("Filenames matching:   %8ld\n", matches);
+    printf("%-22s%8ld\n", just_print ? "Would rename:" : "Renamed:", changes);
+}
+
+int main(int argc, char *argv[])
+{
+    progname = argv[0];
+#ifdef __unix__
+    {
+        char *ptmp;
+        if ((ptmp = strrchr(progname, '/')))
+            progname = ptmp + 1;
+    }
+#endif
+    utol_mode = strcmp(progname, "utol") == 0;
+
+    for (--argc, ++argv; argc > 0 && **argv == '-'; --argc, ++argv) {
+        if (strcmp(*argv, "-h") == 0) {
+            usage();
+            return EXIT_SUCCESS;
+        } else if (strcmp(*argv, "-n") == 0) {
+            just_print = 1;
+        } else if (!utol_mode && strcmp(*argv, "-nr") == 0) {
+            recursive = 0;
+        } else if (!utol_mode && strcmp(*argv, "-r") == 0) {
+            recursive = 1;
+        } else if (strcmp(*argv, "-v") == 0) {
+            verbose = 1;
+        } else if (strncmp(*argv, "-j", 2) == 0) {
+            if ((*argv)[2]) {
+                threads = atoi(*argv + 2);
+            } else if (--argc > 0) {
+                threads = atoi(*++argv);
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+        } else {
+            fprintf(stderr, "Unrecognized switch: %s\n", *argv);
+            return EXIT_FAILURE;
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+
+    if (utol_mode)
+        utol(argc, argv);
+    else
+        renumber(argc, argv);
+    if (fflush(stdout) != 0) {
+        fprintf(stderr, "%s: write error (%s)\n", progname, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* File: filetype.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Prints the format of files as found by the content sniffing of
+ * sniff.c: "text", "data", "empty" or the extension of a known format
+ * like "pdf". With option -t nothing is printed, the exit status is 0
+ * if all files are text files. */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sniff.h"
+
+static int error_count = 0;
+#ifdef __unix__
+static char *progname;
+#else
+static const char *const progname = "filetype";
+#endif
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: %s [-n] [-t] file...\n", progname);
+    fprintf(stderr, "  -n   don't use the cache of results\n"
+                    "  -t   test only, exit status 0 if all files are text\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int test_only = 0, all_text = 1;
+#ifdef __unix__
+    char *ptmp;
+    progname = argv[0];
+    if ((ptmp = strrchr(progname, '/')))
+        progname = ptmp + 1;
+#endif
+
+    for (--argc, ++argv; argc > 0 && **argv == '-' && argv[0][1]; --argc, ++argv) {
+        if (strcmp(*argv, "--") == 0) {
+            --argc;
+            ++argv;
+            break;
+        }
+        while (*++*argv) {
+            switch (**argv) {
+                case 'h':
+                case '?':
+                    usage();
+                    return EXIT_SUCCESS;
+                case 'n':
+                    sniff_use_cache(0);
+                    break;
+                case 't':
+                    test_only = 1;
+                    break;
+                default:
+                    fprintf(stderr, "%s: unknown command line flag '%c'.\n",
+                            progname, **argv);
+                    usage();
+                    return EXIT_FAILURE;
+            }
+        }
+    }
+    if (argc == 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    for (; argc > 0; --argc, ++argv) {
+        const char *format = sniff_path(*argv);
+        if (format == NULL) {
+            fprintf(stderr, "%s: can't read %s (%s)\n", progname, *argv, strerror(errno));
+            ++error_count;
+            all_text = 0;
+        } else if (test_only) {
+            all_text &= strcmp(format, "text") == 0;
+        } else {
+            printf("%s: %s\n", *argv, format);
+        }
+    }
+
+    if (test_only)
+        return all_text ? EXIT_SUCCESS : EXIT_FAILURE;
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,773 @@
+/* File: reflow.c */
+
+/* Version 0.1, Martin Titz, 2026 */
+
+/* Wraps lines longer than the width of the terminal window at whitespace,
+ * like "fmt -s -w<columns>", but streaming: every line is written as soon
+ * as it is read, so a pager shows the first screen at once, also for huge
+ * files. Short lines are not joined, continuation lines get the
+ * indentation of the line they belong to. Words longer than a whole line
+ * are not split. Replaces the pipeline winsize | fmt in the script vf.
+ *
+ * With option -p the file is shown in a simple pager of its own instead
+ * (q quit, space/b page down/up, j/k or cursor keys line down/up, g/G
+ * begin/end). When the terminal window changes its size, only the lines
+ * on the screen are wrapped again, so resizing takes the same time for
+ * every file size. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 262144
+#endif
+
+#define DEFAULT_WIDTH 75        /* like fmt, if there is no terminal */
+#define TABSIZE       8
+#define MAX_INDENT    256
+#define INDEX_STEP    4096      /* distance of line starts in the index */
+
+static int width = 0;
+static int fixed_width = 0;
+static int pager = 0;
+static int error_count = 0;
+static unsigned char buffer[BUFFER_SIZE];
+static unsigned char out[BUFFER_SIZE];
+static size_t out_length = 0;
+static char *progname;
+
+/* State of the line being wrapped, kept across input blocks. */
+static int at_line_start = 1;
+static int col = 0;                     /* output column */
+static int line_has_word = 0;           /* a word after the indentation */
+static unsigned char indent[MAX_INDENT];
+static int indent_length = 0, indent_col = 0;
+static unsigned char *space, *word;     /* pending blanks, current word */
+static size_t space_length = 0, word_length = 0, word_size = 0, space_size = 0;
+static int word_col = 0;                /* columns of word */
+static int word_streaming = 0;          /* word already started on output */
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: %s [-w width] [file]...\n"
+                    "       %s -p [-w width] file\n", progname, progname);
+}
+
+static void arg_err(char c)
+{
+    fprintf(stderr, "%s: option -%c requires an argument.\n", progname, c);
+    usage();
+    exit(EXIT_FAILURE);
+}
+
+/* Width of the terminal like vf computed it from winsize --columns: one
+ * column less than the window for windows wider than 80 columns. Stdout
+ * is usually a pipe to the pager, so stdin, stderr and /dev/tty are
+ * asked instead. */
+static int get_winsize(struct winsize *size)
+{
+    int fd, ok = 0;
+
+    if (ioctl(STDIN_FILENO, TIOCGWINSZ, (char *) size) == 0
+        || ioctl(STDERR_FILENO, TIOCGWINSZ, (char *) size) == 0) {
+        ok = 1;
+    } else if ((fd = open("/dev/tty", O_RDONLY)) >= 0) {
+        ok = ioctl(fd, TIOCGWINSZ, (char *) size) == 0;
+        close(fd);
+    }
+    return ok && size->ws_col > 0;
+}
+
+static int terminal_width(void)
+{
+    struct winsize size;
+
+    if (!get_winsize(&size))
+        return DEFAULT_WIDTH;
+    return size.ws_col > 80 ? size.ws_col - 1 : size.ws_col;
+}
+
+static void flush_output(void)
+{
+    if (out_length > 0 && fwrite(out, 1, out_length, stdout) != out_length) {
+        if (errno != EPIPE)
+            fprintf(stderr, "%s: write error (%s)\n", progname, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    out_length = 0;
+    fflush(stdout);
+}
+
+static void output(const unsigned char *s, size_t n)
+{
+    while (n > 0) {
+        size_t part = BUFFER_SIZE - out_length;
+        if (part > n)
+            part = n;
+        memcpy(out + out_length, s, part);
+        out_length += part;
+        s += part;
+        n -= part;
+        if (out_length == BUFFER_SIZE)
+            flush_output();
+    }
+}
+
+static int advance(int column, unsigned char ch)
+{
+    if (ch == '\t')
+        return (column / TABSIZE + 1) * TABSIZE;
+    /* UTF-8 continuation bytes take no column of their own */
+    return (ch & 0xc0) == 0x80 ? column : column + 1;
+}
+
+static int span(int column, const unsigned char *s, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; ++i)
+        column = advance(column, s[i]);
+    return column;
+}
+
+static unsigned char *append(unsigned char *buf, size_t *length, size_t *size,
+                             unsigned char ch)
+{
+    if (*length == *size) {
+        *size = *size ? 2 * *size : 256;
+        if ((buf = realloc(buf, *size)) == NULL) {
+            fprintf(stderr, "%s: out of memory\n", progname);
+            exit(EXIT_FAILURE);
+        }
+    }
+    buf[(*length)++] = ch;
+    return buf;
+}
+
+/* Starts a continuation line, the pending blanks are dropped. */
+static void break_line(void)
+{
+    output((const unsigned char *)"\n", 1);
+    output(indent, indent_length);
+    col = indent_col;
+    space_length = 0;
+    line_has_word = 0;
+}
+
+/* Places the current word, breaking the line before it if it would not
+ * fit. Called when the word is complete, or as soon as it gets too long
+ * for the current line. */
+static void place_word(void)
+{
+    int end = span(col, space, space_length) + word_col;
+    if (end > width && line_has_word) {
+        break_line();
+        end = col + word_col;
+    }
+    output(space, space_length);
+    output(word, word_length);
+    col = end;
+    space_length = 0;
+    word_length = 0;
+    word_col = 0;
+    line_has_word = 1;
+}
+
+static void end_word(void)
+{
+    if (word_length > 0)
+        place_word();
+    word_streaming = 0;
+}
+
+static void end_line(void)
+{
+    end_word();
+    output((const unsigned char *)"\n", 1);
+    at_line_start = 1;
+    col = 0;
+    line_has_word = 0;
+    indent_length = 0;
+    space_length = 0;
+}
+
+static void wrap_byte(unsigned char ch)
+{
+    if (ch == '\n') {
+        end_line();
+    } else if (ch == ' ' || ch == '\t') {
+        if (at_line_start) {
+            if (indent_length < MAX_INDENT)
+                indent[indent_length++] = ch;
+            col = advance(col, ch);
+            /* keep half a line for the text of continuation lines */
+            indent_col = col <= width / 2 ? col : 0;
+            output(&ch, 1);
+        } else {
+            end_word();
+            space = append(space, &space_length, &space_size, ch);
+        }
+    } else {
+        if (at_line_start) {
+            at_line_start = 0;
+            indent_col = col <= width / 2 ? col : 0;
+            if (indent_col == 0)
+                indent_length = 0;
+        }
+        if (word_streaming) {
+            output(&ch, 1);
+            col = advance(col, ch);
+            return;
+        }
+        word = append(word, &word_length, &word_size, ch);
+        word_col = advance(word_col, ch);
+        if (word_col > width) {
+            /* longer than any line, no need to wait for its end */
+            place_word();
+            word_streaming = 1;
+        }
+    }
+}
+
+/* Takes a run of word bytes at once. Returns the number of bytes
+ * consumed, 0 if the byte by byte path is needed. */
+static size_t add_word_bytes(const unsigned char *p, size_t n)
+{
+    size_t i;
+    int columns = word_col;
+    if (at_line_start || word_streaming)
+        return 0;
+    for (i = 0; i < n && p[i] != ' ' && p[i] != '\t' && p[i] != '\n'; ++i)
+        columns += (p[i] & 0xc0) != 0x80;
+    if (i == 0 || columns > width)
+        return 0;
+    if (word_length + i > word_size) {
+        while (word_length + i > word_size)
+            word_size = word_size ? 2 * word_size : 256;
+        if ((word = realloc(word, word_size)) == NULL) {
+            fprintf(stderr, "%s: out of memory\n", progname);
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(word + word_length, p, i);
+    word_length += i;
+    word_col = columns;
+    return i;
+}
+
+/* Fast path for complete lines which fit already: the line is copied
+ * unchanged if it has no more bytes than columns and contains no tab.
+ * Returns the number of bytes consumed, 0 if the slow path is needed. */
+static size_t copy_short_line(const unsigned char *p, size_t n)
+{
+    size_t limit = n < (size_t)width + 1 ? n : (size_t)width + 1;
+    const unsigned char *nl = memchr(p, '\n', limit);
+    if (nl == NULL || memchr(p, '\t', nl - p) != NULL)
+        return 0;
+    output(p, nl + 1 - p);
+    return nl + 1 - p;
+}
+
+static void reflow(int fd, const char *fname)
+{
+    ssize_t bytes;
+
+    while ((bytes = read(fd, buffer, BUFFER_SIZE)) != 0) {
+        size_t i = 0;
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "%s: read error on %s (%s)\n",
+                    progname, fname, strerror(errno));
+            ++error_count;
+            break;
+        }
+        while (i < (size_t)bytes) {
+            size_t done = at_line_start && col == 0
+                          ? copy_short_line(buffer + i, bytes - i)
+                          : add_word_bytes(buffer + i, bytes - i);
+            if (done > 0)
+                i += done;
+            else
+                wrap_byte(buffer[i++]);
+        }
+        /* the pager gets every block as soon as it is done */
+        flush_output();
+    }
+}
+
+static void finish(void)
+{
+    /* complete a last line without line end, but add no line end */
+    end_word();
+    output(space, space_length);
+    space_length = 0;
+    flush_output();
+}
+
+static void do_file(const char *fname)
+{
+    int fd;
+
+    if ((fd = open(fname, O_RDONLY)) < 0) {
+        fprintf(stderr, "%s: can't open %s (%s)\n",
+                progname, fname, strerror(errno));
+        ++error_count;
+        return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    reflow(fd, fname);
+    close(fd);
+}
+
+/* Pager. The file is mapped, and an index of line starts, at most one
+ * per INDEX_STEP bytes, is built once with memchr(). Each line is wrapped
+ * on its own, so a line is the unit which is wrapped again after a resize:
+ * the position on the screen is kept as the line start and the byte
+ * offset of the first row shown, rows are computed from the line start
+ * only for the lines on or next to the screen. */
+
+struct position {
+    size_t line;        /* start of the input line */
+    size_t row;         /* start of the row within that line */
+};
+
+static const unsigned char *text;
+static size_t text_size;
+static size_t *line_index;
+static size_t index_count;
+static int term_fd = -1;
+static int screen_rows, screen_cols;
+static struct termios saved_termios;
+static volatile sig_atomic_t resized = 0;
+
+static void build_index(void)
+{
+    size_t max = text_size / INDEX_STEP + 2;
+    size_t pos = 0;
+
+    if ((line_index = malloc(max * sizeof(*line_index))) == NULL) {
+        fprintf(stderr, "%s: out of memory\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    index_count = 0;
+    while (pos < text_size && index_count < max) {
+        const unsigned char *nl;
+        line_index[index_count++] = pos;
+        if (pos + INDEX_STEP >= text_size)
+            break;
+        nl = memchr(text + pos + INDEX_STEP - 1, '\n', text_size - pos - INDEX_STEP + 1);
+        if (nl == NULL)
+            break;
+        pos = nl + 1 - text;
+    }
+}
+
+/* End of the input line starting at pos, not including the line end. */
+static size_t line_end(size_t pos)
+{
+    const unsigned char *nl = memchr(text + pos, '\n', text_size - pos);
+    return nl ? (size_t)(nl - text) : text_size;
+}
+
+/* Start of the input line containing pos, searched forward from the
+ * last indexed line start before pos. */
+static size_t line_start(size_t pos)
+{
+    size_t lo = 0, hi = index_count, start;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (line_index[mid] <= pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    start = index_count > 0 ? line_index[lo] : 0;
+    for (;;) {
+        const unsigned char *nl = memchr(text + start, '\n', pos - start);
+        if (nl == NULL)
+            return start;
+        start = nl + 1 - text;
+    }
+}
+
+/* Indentation of a line as used for its continuation rows, see wrap_byte. */
+static int line_indent(size_t line, size_t end, size_t *indent_end)
+{
+    size_t i = line;
+    int c = 0;
+    while (i < end && (text[i] == ' ' || text[i] == '\t'))
+        c = advance(c, text[i++]);
+    *indent_end = i;
+    return c <= width / 2 ? c : 0;
+}
+
+/* Computes the row starting at row within the line starting at line, in
+ * the same way as the streaming wrapper. Returns the end of the text of
+ * the row, *next receives the start of the next row or the line end. */
+static size_t wrap_row(size_t line, size_t row, size_t end, size_t *next)
+{
+    size_t indent_end, i, row_end;
+    int c = line_indent(line, end, &indent_end);
+    int has_word = 0;
+
+    if (row == line) {
+        c = 0;
+        i = line;
+        while (i < indent_end)
+            c = advance(c, text[i++]);
+    } else {
+        i = row;
+    }
+    row_end = i;
+    while (i < end) {
+        size_t w = i;
+        int wc = c;
+        while (w < end && (text[w] == ' ' || text[w] == '\t'))
+            wc = advance(wc, text[w++]);
+        if (w == end)
+            break;
+        while (w < end && text[w] != ' ' && text[w] != '\t')
+            wc = advance(wc, text[w++]);
+        if (wc > width && has_word)
+            break;
+        c = wc;
+        i = row_end = w;
+        has_word = 1;
+    }
+    while (i < end && (text[i] == ' ' || text[i] == '\t'))
+        ++i;
+    *next = i;
+    return row_end;
+}
+
+static int next_row(struct position *p)
+{
+    size_t end = line_end(p->line);
+    size_t next;
+    wrap_row(p->line, p->row, end, &next);
+    if (next < end) {
+        p->row = next;
+        return 1;
+    }
+    if (end + 1 >= text_size)
+        return 0;
+    p->line = p->row = end + 1;
+    return 1;
+}
+
+/* Start of the row of the line containing offset. */
+static size_t row_containing(size_t line, size_t end, size_t offset)
+{
+    size_t row = line, next;
+    for (;;) {
+        wrap_row(line, row, end, &next);
+        if (next >= end || next > offset)
+            return row;
+        row = next;
+    }
+}
+
+static int prev_row(struct position *p)
+{
+    if (p->row > p->line) {
+        p->row = row_containing(p->line, line_end(p->line), p->row - 1);
+        return 1;
+    }
+    if (p->line == 0)
+        return 0;
+    p->line = line_start(p->line - 1);
+    p->row = row_containing(p->line, line_end(p->line), text_size);
+    return 1;
+}
+
+/* Writes to the terminal, a failure can't be reported there anyway. */
+static void term_write(const void *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t k = write(term_fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return;
+        p = (const char *)p + k;
+        n -= k;
+    }
+}
+
+static void restore_terminal(void)
+{
+    static const char leave[] = "\033[?25h\033[?1049l";
+    if (term_fd >= 0) {
+        term_write(leave, sizeof(leave) - 1);
+        tcsetattr(term_fd, TCSAFLUSH, &saved_termios);
+    }
+}
+
+static void on_signal(int sig)
+{
+    if (sig == SIGWINCH) {
+        resized = 1;
+    } else {
+        restore_terminal();
+        signal(sig, SIG_DFL);
+        raise(sig);
+    }
+}
+
+static void update_size(void)
+{
+    struct winsize size;
+    if (ioctl(term_fd, TIOCGWINSZ, (char *) &size) != 0 || size.ws_row < 2) {
+        size.ws_row = 24;
+        size.ws_col = 80;
+    }
+    screen_rows = size.ws_row - 1;
+    screen_cols = size.ws_col;
+    if (!fixed_width)
+        width = screen_cols > 80 ? screen_cols - 1 : screen_cols;
+}
+
+/* Shows one row, cut at the screen width and with control characters
+ * replaced, so every row takes exactly one line on the screen. */
+static void draw_row(const struct position *p)
+{
+    size_t end = line_end(p->line);
+    size_t next, i, indent_end;
+    size_t row_end = wrap_row(p->line, p->row, end, &next);
+    int c = 0;
+
+    if (p->row > p->line && line_indent(p->line, end, &indent_end) > 0) {
+        for (i = p->line; i < indent_end; ++i)
+            c = advance(c, text[i]);
+        output(text + p->line, indent_end - p->line);
+    }
+    for (i = p->row; i < row_end; ++i) {
+        unsigned char ch = text[i];
+        int nc = advance(c, ch);
+        if (nc > screen_cols)
+            break;
+        if (ch < 32 && ch != '\t' || ch == 127)
+            ch = '?';
+        output(&ch, 1);
+        c = nc;
+    }
+}
+
+static void draw_screen(const struct position *top, const char *fname)
+{
+    struct position p = *top;
+    char status[256];
+    int r, more = 1;
+
+    output((const unsigned char *)"\033[H", 3);
+    for (r = 0; r < screen_rows; ++r) {
+        if (more)
+            draw_row(&p);
+        output((const unsigned char *)"\033[K\r\n", 5);
+        if (more)
+            more = next_row(&p);
+    }
+    snprintf(status, sizeof(status), "\033[7m %s  %d%%  (width %d) \033[0m\033[K",
+             fname, text_size ? (int)(100.0 * top->row / text_size) : 100, width);
+    output((const unsigned char *)status, strlen(status));
+    term_write(out, out_length);
+    out_length = 0;
+}
+
+static int read_key(void)
+{
+    unsigned char buf[8];
+    ssize_t n = read(term_fd, buf, sizeof(buf));
+    if (n <= 0)
+        return n < 0 && errno == EINTR ? 0 : 'q';
+    if (n >= 3 && buf[0] == 033 && buf[1] == '[') {
+        switch (buf[2]) {
+            case 'A': return 'k';
+            case 'B': return 'j';
+            case 'H': return 'g';
+            case 'F': return 'G';
+            case '5': return 'b';
+            case '6': return ' ';
+        }
+        return 0;
+    }
+    return buf[0];
+}
+
+static void view_file(const char *fname)
+{
+    struct position top = { 0, 0 };
+    struct termios raw;
+    struct sigaction sa;
+    struct stat st;
+    int fd, i, key;
+
+    if ((fd = open(fname, O_RDONLY)) < 0) {
+        fprintf(stderr, "%s: can't open %s (%s)\n",
+                progname, fname, strerror(errno));
+        ++error_count;
+        return;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        fprintf(stderr, "%s: %s is no regular file or empty\n", progname, fname);
+        ++error_count;
+        close(fd);
+        return;
+    }
+    text_size = st.st_size;
+    text = mmap(0, text_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        fprintf(stderr, "%s: can't map %s (%s)\n",
+                progname, fname, strerror(errno));
+        ++error_count;
+        return;
+    }
+    build_index();
+
+    if ((term_fd = open("/dev/tty", O_RDWR)) < 0 || tcgetattr(term_fd, &saved_termios) != 0) {
+        fprintf(stderr, "%s: no terminal for the pager\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    raw = saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(term_fd, TCSAFLUSH, &raw);
+    atexit(restore_terminal);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;      /* no SA_RESTART, read() returns EINTR */
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGWINCH, &sa, 0);
+    sigaction(SIGINT, &sa, 0);
+    sigaction(SIGTERM, &sa, 0);
+    term_write("\033[?1049h\033[?25l", 14);
+
+    update_size();
+    for (;;) {
+        draw_screen(&top, fname);
+        key = read_key();
+        if (resized) {
+            resized = 0;
+            update_size();
+            /* keep the first byte shown at the top */
+            top.row = row_containing(top.line, line_end(top.line), top.row);
+        }
+        switch (key) {
+            case 'q':
+                restore_terminal();
+                term_fd = -1;
+                munmap((void *)text, text_size);
+                free(line_index);
+                return;
+            case ' ':
+            case 'f':
+                for (i = 0; i < screen_rows - 1 && next_row(&top); ++i)
+                    ;
+                break;
+            case 'b':
+                for (i = 0; i < screen_rows - 1 && prev_row(&top); ++i)
+                    ;
+                break;
+            case 'j':
+            case '\r':
+            case '\n':
+                next_row(&top);
+                break;
+            case 'k':
+                prev_row(&top);
+                break;
+            case 'g':
+                top.line = top.row = 0;
+                break;
+            case 'G':
+                top.line = line_start(text_size - 1);
+                top.row = row_containing(top.line, line_end(top.line), text_size);
+                for (i = 0; i < screen_rows - 1 && prev_row(&top); ++i)
+                    ;
+                break;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int do_opts = 1;
+    int files_done = 0;
+    char *ptmp;
+    progname = argv[0];
+    if ((ptmp = strrchr(progname, '/')))
+        progname = ptmp + 1;
+
+    for (--argc, ++argv;  argc > 0;  --argc, ++argv) {
+        if (**argv == '-' && do_opts) {
+            if (argv[0][1] == 0) {
+                if (width <= 0)
+                    width = terminal_width();
+                reflow(STDIN_FILENO, "stdin");
+                ++files_done;
+                continue;
+            }
+            while (*++*argv) {
+                switch (**argv) {
+                    case 'h':
+                    case '?':
+                        usage();
+                        return EXIT_SUCCESS;
+                    case 'p':
+                        pager = 1;
+                        break;
+                    case 'w':
+                        if (*++*argv || --argc && *++argv) {
+                            width = atoi(*argv);
+                            fixed_width = width > 0;
+                        } else
+                            arg_err('w');
+                        goto nextarg;
+                    case '-':
+                        do_opts = 0;
+                        break;
+                    default:
+                        fprintf(stderr, "%s: unknown command line flag '%c'.\n",
+                                progname, **argv);
+                        usage();
+                        return EXIT_FAILURE;
+                }
+            }
+        } else if (pager) {
+            view_file(*argv);
+            ++files_done;
+        } else {
+            if (width <= 0)
+                width = terminal_width();
+            do_file(*argv);
+            ++files_done;
+        }
+        nextarg: ;
+    }
+    if (pager) {
+        if (!files_done) {
+            fprintf(stderr, "%s: option -p needs a file.\n", progname);
+            usage();
+            return EXIT_FAILURE;
+        }
+        return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    if (width <= 0)
+        width = terminal_width();
+    if (!files_done)
+        reflow(STDIN_FILENO, "stdin");
+    finish();
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,434 @@
+/* File: sniff.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Content sniffing for the script v, which called file -L for every file
+ * without a known extension. Only the first SNIFF_SIZE bytes are read,
+ * with a single pread(). Known formats are recognized by a small table of
+ * magic numbers and a few refinements (ZIP based office formats, RIFF,
+ * ISO media, HTML and SVG). Anything else is text if it has none of the
+ * control characters which file(1) doesn't accept in text, the test runs
+ * on 8 bytes at once.
+ *
+ * Results are kept in $XDG_CACHE_HOME/sniff.cache (or ~/.cache), a
+ * direct mapped table of fixed size which is mapped into memory. A
+ * result is valid while device, inode, modification time and size of
+ * the file are unchanged; a check value detects entries overwritten
+ * by concurrent processes. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "sniff.h"
+
+#define CACHE_MAGIC   "SNIFFC\n"
+#define CACHE_VERSION 1         /* to be increased when formats change */
+#define CACHE_SLOTS   8192      /* a power of two */
+
+/* The index in this list is what the cache stores, so new formats are
+ * only appended. */
+static const char *const formats[] = {
+    "", "empty", "text", "data", "special",
+    "7z", "avi", "bzip2", "class", "djvu", "doc", "docx", "dvi", "elf",
+    "eps", "fig", "flv", "gblorb", "gif", "gzip", "html", "ico", "iff",
+    "jar", "jpg", "kra", "m4v", "mov", "mp3", "mp4", "mpeg", "odp", "ods",
+    "odt", "ogg", "pdf", "png", "pptx", "ps", "rar", "riff", "rm", "rtf",
+    "sqlite", "svg", "tar", "wav", "webp", "wmv", "xcf", "xlsx", "zip",
+    0
+};
+
+struct magic {
+    unsigned short offset, length;
+    const char *bytes;
+    const char *format;
+};
+
+/* First match wins, so longer magics come before their prefixes. */
+static const struct magic magics[] = {
+    { 0, 8, "\x89PNG\r\n\x1a\n", "png" },
+    { 0, 8, "\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1", "doc" },     /* OLE2: doc, xls, ppt, vsd */
+    { 0, 8, "\x30\x26\xb2\x75\x8e\x66\xcf\x11", "wmv" },     /* ASF: wmv, wma */
+    { 0, 8, "AT&TFORM", "djvu" },
+    { 0, 8, "gimp xcf", "xcf" },
+    { 0, 16, "SQLite format 3", "sqlite" },                 /* with the '\0' */
+    { 0, 6, "7z\xbc\xaf\x27\x1c", "7z" },
+    { 0, 6, "Rar!\x1a\x07", "rar" },
+    { 0, 6, "GIF87a", "gif" },
+    { 0, 6, "GIF89a", "gif" },
+    { 0, 5, "%PDF-", "pdf" },
+    { 0, 5, "{\\rtf", "rtf" },
+    { 0, 4, "\xca\xfe\xba\xbe", "class" },
+    { 0, 4, "\xc5\xd0\xd3\xc6", "eps" },                     /* DOS EPS binary */
+    { 0, 4, "\x7f" "ELF", "elf" },
+    { 0, 4, "#FIG", "fig" },
+    { 0, 4, "FLV\x01", "flv" },
+    { 0, 4, "OggS", "ogg" },
+    { 0, 4, ".RMF", "rm" },
+    { 0, 4, "\x00\x00\x01\xba", "mpeg" },
+    { 0, 4, "\x00\x00\x01\xb3", "mpeg" },
+    { 0, 4, "\x00\x00\x01\x00", "ico" },
+    { 0, 4, "PK\x03\x04", "zip" },
+    { 0, 4, "RIFF", "riff" },
+    { 0, 4, "FORM", "iff" },
+    { 4, 4, "ftyp", "mp4" },
+    { 257, 5, "ustar", "tar" },
+    { 0, 3, "\xff\xd8\xff", "jpg" },
+    { 0, 3, "ID3", "mp3" },
+    { 0, 3, "BZh", "bzip2" },
+    { 0, 2, "\x1f\x8b", "gzip" },
+    { 0, 2, "\xf7\x02", "dvi" },
+    { 0, 2, "%!", "ps" },
+    { 0, 0, 0, 0 }
+};
+
+struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint64_t reserved[2];
+};
+
+struct cache_entry {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    uint32_t mtime_nsec;
+    uint16_t format;
+    uint16_t check;
+};
+
+static int use_cache = 1;
+static int cache_state = 0;     /* 0 not opened, 1 mapped, -1 unavailable */
+static struct cache_entry *cache;
+
+/* Control characters file(1) doesn't accept in text: all below 0x20
+ * except BEL, BS, HT, LF, FF, CR and ESC, and DEL. */
+static const uint32_t binary_controls = ~(uint32_t) (0x3780 | 1u << 0x1b);
+
+/* Byte mask of the bytes of x below 0x20, exact for every byte. */
+static uint64_t below_space(uint64_t x)
+{
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL, high = 0x8080808080808080ULL;
+    return ~(((x & low7) + 0x6060606060606060ULL) | x) & high;
+}
+
+/* Byte mask of the zero bytes of x, exact for every byte. */
+static uint64_t zero_bytes(uint64_t x)
+{
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL, high = 0x8080808080808080ULL;
+    return ~(((x & low7) + low7) | x) & high;
+}
+
+static int is_binary_byte(unsigned char c)
+{
+    return c < 0x20 ? binary_controls >> c & 1 : c == 0x7f;
+}
+
+static int looks_like_text(const unsigned char *p, size_t n)
+{
+    size_t i = 0;
+
+    if (n >= 2 && (p[0] == 0xff && p[1] == 0xfe || p[0] == 0xfe && p[1] == 0xff))
+        return 1;                                       /* UTF-16 */
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, mask;
+        memcpy(&x, p + i, 8);
+        mask = below_space(x) | zero_bytes(x ^ 0x7f7f7f7f7f7f7f7fULL);
+        if (mask != 0) {
+            /* mostly line ends, checked one by one */
+            int k;
+            for (k = 0; k < 8; ++k) {
+                if (is_binary_byte(p[i + k]))
+                    return 0;
+            }
+        }
+    }
+    for (; i < n; ++i) {
+        if (is_binary_byte(p[i]))
+            return 0;
+    }
+    return 1;
+}
+
+static int has_prefix(const unsigned char *p, size_t n, const char *s)
+{
+    size_t length = strlen(s);
+    return n >= length && memcmp(p, s, length) == 0;
+}
+
+static int has_prefix_nocase(const unsigned char *p, size_t n, const char *s)
+{
+    size_t i, length = strlen(s);
+    if (n < length)
+        return 0;
+    for (i = 0; i < length; ++i) {
+        unsigned char c = p[i];
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        if (c != (unsigned char) s[i])
+            return 0;
+    }
+    return 1;
+}
+
+static const unsigned char *find(const unsigned char *p, size_t n, const char *s)
+{
+    size_t length = strlen(s);
+    const unsigned char *end = p + n;
+    while (p + length <= end && (p = memchr(p, s[0], end - p - length + 1)) != NULL) {
+        if (memcmp(p, s, length) == 0)
+            return p;
+        ++p;
+    }
+    return NULL;
+}
+
+/* ZIP archives: OpenDocument and Krita files start with an entry
+ * mimetype, stored uncompressed, Office Open XML and jar files are
+ * recognized by the names of their entries. */
+static const char *zip_format(const unsigned char *p, size_t n)
+{
+    static const char mimetype[] = "mimetype";
+    size_t name_length, extra_length;
+
+    if (n < 30)
+        return "zip";
+    name_length = p[26] | p[27] << 8;
+    extra_length = p[28] | p[29] << 8;
+    if (name_length == 8 && has_prefix(p + 30, n - 30, mimetype)
+        && 30 + name_length + extra_length < n) {
+        const unsigned char *m = p + 30 + name_length + extra_length;
+        size_t left = n - (m - p);
+        if (has_prefix(m, left, "application/vnd.oasis.opendocument.text"))
+            return "odt";
+        if (has_prefix(m, left, "application/vnd.oasis.opendocument.spreadsheet"))
+            return "ods";
+        if (has_prefix(m, left, "application/vnd.oasis.opendocument.presentation"))
+            return "odp";
+        if (has_prefix(m, left, "application/x-krita"))
+            return "kra";
+        return "zip";
+    }
+    if (has_prefix(p + 30, n - 30, "META-INF/"))
+        return "jar";
+    if (find(p, n, "word/"))
+        return "docx";
+    if (find(p, n, "xl/"))
+        return "xlsx";
+    if (find(p, n, "ppt/"))
+        return "pptx";
+    if (has_prefix(p + 30, n - 30, "[Content_Types].xml") || has_prefix(p + 30, n - 30, "_rels/"))
+        return "docx";
+    return "zip";
+}
+
+/* HTML and SVG files, possibly after a byte order mark and blanks. */
+static const char *markup_format(const unsigned char *p, size_t n)
+{
+    const unsigned char *end = p + n;
+
+    if (has_prefix(p, n, "\xef\xbb\xbf"))
+        p += 3;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+        ++p;
+    n = end - p;
+    if (has_prefix_nocase(p, n, "<!doctype html") || has_prefix_nocase(p, n, "<html"))
+        return "html";
+    if (has_prefix(p, n, "<svg")
+        || has_prefix(p, n, "<?xml") && find(p, n, "<svg") != NULL)
+        return "svg";
+    return NULL;
+}
+
+const char *sniff_buffer(const void *data, size_t n)
+{
+    const unsigned char *p = data;
+    const struct magic *m;
+    const char *format;
+
+    if (n == 0)
+        return "empty";
+    for (m = magics; m->bytes; ++m) {
+        if (n >= (size_t) m->offset + m->length
+            && memcmp(p + m->offset, m->bytes, m->length) == 0)
+            break;
+    }
+    format = m->format;
+    if (format == NULL) {
+        if (n >= 2 && p[0] == 0xff && (p[1] & 0xf6) == 0xf2)
+            format = "mp3";                             /* MPEG audio frame */
+    } else if (strcmp(format, "zip") == 0) {
+        format = zip_format(p, n);
+    } else if (strcmp(format, "riff") == 0 && n >= 12) {
+        if (memcmp(p + 8, "AVI ", 4) == 0)
+            format = "avi";
+        else if (memcmp(p + 8, "WAVE", 4) == 0)
+            format = "wav";
+        else if (memcmp(p + 8, "WEBP", 4) == 0)
+            format = "webp";
+    } else if (strcmp(format, "iff") == 0 && n >= 12) {
+        if (memcmp(p + 8, "IFRS", 4) == 0)
+            format = "gblorb";
+    } else if (strcmp(format, "mp4") == 0 && n >= 12) {
+        if (memcmp(p + 8, "qt  ", 4) == 0)
+            format = "mov";
+        else if (memcmp(p + 8, "M4V", 3) == 0)
+            format = "m4v";
+    } else if (strcmp(format, "ps") == 0) {
+        const unsigned char *nl = memchr(p, '\n', n);
+        size_t line = nl ? (size_t) (nl - p) : n;
+        if (has_prefix(p, n, "%!PS-Adobe-") && find(p, line, " EPSF-") != NULL)
+            format = "eps";
+    }
+    if (format == NULL)
+        format = markup_format(p, n);
+    if (format == NULL)
+        format = looks_like_text(p, n) ? "text" : "data";
+    return format;
+}
+
+static int format_index(const char *format)
+{
+    int i;
+    for (i = 1; formats[i]; ++i) {
+        if (strcmp(formats[i], format) == 0)
+            return i;
+    }
+    return 0;
+}
+
+static void open_cache(void)
+{
+    const size_t size = sizeof(struct cache_header) + CACHE_SLOTS * sizeof(struct cache_entry);
+    const char *dir = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+    struct cache_header *h;
+    struct stat st;
+    char *name;
+    void *map;
+    int fd;
+
+    cache_state = -1;
+    if (dir != NULL && *dir) {
+        if ((name = malloc(strlen(dir) + 16)) == NULL)
+            return;
+        strcat(strcpy(name, dir), "/sniff.cache");
+    } else if (home != NULL && *home) {
+        if ((name = malloc(strlen(home) + 24)) == NULL)
+            return;
+        strcat(strcpy(name, home), "/.cache");
+        mkdir(name, 0700);
+        strcat(name, "/sniff.cache");
+    } else {
+        return;
+    }
+    fd = open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    free(name);
+    if (fd < 0)
+        return;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size != size && ftruncate(fd, size) != 0) {
+        close(fd);
+        return;
+    }
+    map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return;
+    h = map;
+    if (memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0
+        || h->version != CACHE_VERSION || h->slots != CACHE_SLOTS) {
+        memset(map, 0, size);
+        memcpy(h->magic, CACHE_MAGIC, sizeof(h->magic));
+        h->version = CACHE_VERSION;
+        h->slots = CACHE_SLOTS;
+    }
+    cache = (struct cache_entry *) (h + 1);
+    cache_state = 1;
+}
+
+static uint64_t mix(uint64_t h, uint64_t x)
+{
+    h ^= x;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return h ^ h >> 29;
+}
+
+/* Check value of an entry, never 0 so that empty slots don't match. */
+static uint16_t entry_check(const struct cache_entry *e, const struct stat *st)
+{
+    uint64_t h = mix(mix(mix(mix(mix(1, e->dev), e->ino), (uint64_t) e->mtime_sec),
+                         e->mtime_nsec), (uint64_t) st->st_size);
+    h = mix(h, e->format);
+    return (uint16_t) (h % 65535 + 1);
+}
+
+static struct cache_entry *cache_slot(const struct stat *st)
+{
+    if (!use_cache)
+        return NULL;
+    if (cache_state == 0)
+        open_cache();
+    if (cache_state < 0)
+        return NULL;
+    return &cache[mix(mix(0, st->st_dev), st->st_ino) & (CACHE_SLOTS - 1)];
+}
+
+const char *sniff_path(const char *path)
+{
+    unsigned char buffer[SNIFF_SIZE];
+    struct cache_entry *slot, e;
+    const char *format;
+    struct stat st;
+    ssize_t n;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC | O_NONBLOCK)) < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        return "special";
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.dev = st.st_dev;
+    e.ino = st.st_ino;
+    e.mtime_sec = st.st_mtim.tv_sec;
+    e.mtime_nsec = st.st_mtim.tv_nsec;
+    if ((slot = cache_slot(&st)) != NULL) {
+        struct cache_entry found = *slot;
+        if (found.dev == e.dev && found.ino == e.ino && found.mtime_sec == e.mtime_sec
+            && found.mtime_nsec == e.mtime_nsec && found.format > 0
+            && found.format < sizeof(formats) / sizeof(*formats) - 1
+            && found.check == entry_check(&found, &st)) {
+            close(fd);
+            return formats[found.format];
+        }
+    }
+
+    while ((n = pread(fd, buffer, sizeof(buffer), 0)) < 0 && errno == EINTR)
+        ;
+    close(fd);
+    if (n < 0)
+        return NULL;
+    format = sniff_buffer(buffer, n);
+    if (slot != NULL && (e.format = format_index(format)) > 0) {
+        e.check = entry_check(&e, &st);
+        *slot = e;
+    }
+    return format;
+}
+
+void sniff_use_cache(int on)
+{
+    use_cache = on;
+}
@@ -0,0 +1,38 @@
+/* File: sniff.h */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Content sniffing: tells text files from binary ones and recognizes
+ * the formats of the script v by their magic numbers. Formats are
+ * returned as static strings: "text", "empty", "data" for unknown binary
+ * content, "special" for files which are not regular, or the name of a
+ * format, the file extension used in displayRules of v where there is
+ * one ("pdf", "png", "doc", ...). */
+
+#ifndef SNIFF_H
+#define SNIFF_H
+
+#include <stddef.h>
+
+#define SNIFF_SIZE 8192         /* bytes examined at the start of a file */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Format of a file start of n bytes. */
+const char *sniff_buffer(const void *data, size_t n);
+
+/* Format of the file path, symbolic links are followed. Results are
+ * kept in a cache keyed by device, inode, modification time and size.
+ * Returns NULL with errno set if the file can't be opened or read. */
+const char *sniff_path(const char *path);
+
+/* Switches the cache off (0) or on again, it is on by default. */
+void sniff_use_cache(int on);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,5 @@
 /* Determine if a calendar can be reused for another year in a given range.  *
- * by Martin Titz, 2025                                                      *
+ * by Martin Titz, 2025, 2026                                                *
  *                                                                           *
  * A wall calendar is considered to be reusable, if the weekdays are         *
  * matching for the whole year (or the days until February 28th or from      *
@@ -11,19 +11,163 @@
  * storing them in the file reusable_cal.txt.                                *
  *   (the ./ at beginning is on Unix-like systems required if executable is  *
  *    not residing in a directory which is in the search path for commands.  *
+ *                                                                           *
+ * The Gregorian calendar repeats itself after 400 years (146097 days are    *
+ * exactly 20871 weeks), so the calendar class of every year is looked up    *
+ * in a table for one such cycle. Years up to 2^63-1 are accepted, and the   *
+ * output is written while going through the range, without storing it.     *
+ *                                                                           *
+ * With option -q the program answers queries instead: it reads one year     *
+ * per line from stdin and writes for each the year itself, the previous     *
+ * and the next year with the same calendar ('-' if there is none). With     *
+ * -e also the date of Easter has to match; Easter dates repeat only after   *
+ * 5700000 years, tables for this cycle are built once at startup.           *
+ *     echo 2025 | ./reusable_cal -q      ->   2025 2014 2031                *
  *                                                                           */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static int is_leap_year(int year)
+#define CYCLE   400
+#define CLASSES  14
+
+#define EASTER_CYCLE  5700000L
+#define EASTER_DATES  35        /* March 22nd until April 25th */
+
+/* Calendar class of the years of one 400 year cycle, indexed by year modulo
+ * 400: the weekday of January 1st (0 = Sunday) plus 7 for leap years. */
+static unsigned char cycle_class[CYCLE];
+
+/* Offsets within the cycle for each calendar class, in ascending order. */
+static short class_offset[CLASSES][CYCLE];
+static int class_count[CLASSES];
+
+static int is_leap_year(long long year)
 {
     return year % 4 == 0 && year % 100 != 0 || year % 400 == 0;
 }
 
-static void print_case(int no, int first, int last, int cal_class[], const char *months)
+static void init_cycle_table(void)
+{
+    int weekday = 6;            /* January 1st, 2000 was a Saturday */
+    for (int i = 0; i < CYCLE; ++i) {
+        int c = weekday + (is_leap_year(i) ? 7 : 0);
+        cycle_class[i] = c;
+        class_offset[c][class_count[c]++] = i;
+        weekday = (weekday + (is_leap_year(i) ? 2 : 1)) % 7;
+    }
+}
+
+/* Distances to the previous and next year of the same class, indexed by
+ * the position in the cycle; filled by build_distances(). */
+static unsigned short class_prev[CYCLE], class_next[CYCLE];
+static unsigned short *easter_prev, *easter_next;
+
+/* Easter Sunday by the anonymous Gregorian algorithm (Meeus/Jones/Butcher),
+ * as number of days after March 22nd. */
+static int easter_offset(long long year)
+{
+    long long a = year % 19, b = year / 100, c = year % 100;
+    long long d = b / 4, e = b % 4;
+    long long f = (b + 8) / 25, g = (b - f + 1) / 3;
+    long long h = (19 * a + b - d - g + 15) % 30;
+    long long i = c / 4, k = c % 4;
+    long long l = (32 + 2 * e + 2 * i - h - k) % 7;
+    long long m = (a + 11 * h + 22 * l) / 451;
+    int month = (h + l - 7 * m + 114) / 31;
+    int day = (h + l - 7 * m + 114) % 31 + 1;
+    return month == 3 ? day - 22 : day + 9;
+}
+
+/* Computes for each position in a cycle of the given period the distances
+ * to the previous and next position with the same key. The key is the
+ * calendar class, combined with the Easter date if easter is not null.
+ * Going twice through the cycle handles the wrap around at its ends. */
+static void build_distances(long period, const unsigned char *easter,
+                            unsigned short *prev, unsigned short *next)
+{
+    long last[CLASSES * EASTER_DATES];
+    int keys = CLASSES * EASTER_DATES;
+
+    for (int k = 0; k < keys; ++k)
+        last[k] = -1;
+    for (long t = 0; t < 2 * period; ++t) {
+        long i = t % period;
+        int k = cycle_class[i % CYCLE] * EASTER_DATES + (easter ? easter[i] : 0);
+        if (t >= period)
+            prev[i] = t - last[k];
+        last[k] = t;
+    }
+    for (int k = 0; k < keys; ++k)
+        last[k] = -1;
+    for (long t = 2 * period - 1; t >= 0; --t) {
+        long i = t % period;
+        int k = cycle_class[i % CYCLE] * EASTER_DATES + (easter ? easter[i] : 0);
+        if (t < period)
+            next[i] = last[k] - t;
+        last[k] = t;
+    }
+}
+
+static int init_easter_table(void)
+{
+    unsigned char *easter = malloc(EASTER_CYCLE);
+    easter_prev = malloc(EASTER_CYCLE * sizeof(*easter_prev));
+    easter_next = malloc(EASTER_CYCLE * sizeof(*easter_next));
+    if (easter == NULL || easter_prev == NULL || easter_next == NULL)
+        return 0;
+    for (long i = 0; i < EASTER_CYCLE; ++i)
+        easter[i] = easter_offset(i);
+    build_distances(EASTER_CYCLE, easter, easter_prev, easter_next);
+    free(easter);
+    return 1;
+}
+
+/* Calendar class of a year from 1583 on, see cycle_class. */
+static int calendar_class(long long year)
 {
+    return cycle_class[year % CYCLE];
+}
+
+/* Prints the years from first to last of calendar class c1 or c2 in
+ * ascending order, going through the range cycle by cycle. */
+static int print_years(long long first, long long last, int c1, int c2)
+{
+    int offset[2 * CYCLE];
+    int n = 0, i = 0, j = 0;
+
+    /* merge the offsets of both classes */
+    while (i < class_count[c1] || c2 >= 0 && j < class_count[c2]) {
+        if (c2 < 0 || j >= class_count[c2]
+            || i < class_count[c1] && class_offset[c1][i] < class_offset[c2][j])
+            offset[n++] = class_offset[c1][i++];
+        else
+            offset[n++] = class_offset[c2][j++];
+    }
+
+    int has_entries = 0;
+    for (long long base = first - first % CYCLE; ; base += CYCLE) {
+        for (int k = 0; k < n; ++k) {
+            if (offset[k] < first - base)
+                continue;
+            if (offset[k] > last - base)
+                return has_entries;
+            printf(" %4lld", base + offset[k]);
+            has_entries = 1;
+        }
+        if (last - base < CYCLE)
+            return has_entries;
+    }
+}
+
+/* Classes are numbered relative to the first year of the range, so the
+ * output starts with the calendar of the first year. */
+static void print_case(int no, long long first, long long last, const char *months)
+{
+    int first_weekday = calendar_class(first) % 7;
     printf("\nReusable calendars for %s:\n", months);
     int c_end = no == 1 ? 14 : 7;
     for (int c = 0; c < c_end; ++c) {
@@ -38,15 +182,62 @@ static void print_case(int no, int first, int last, int cal_class[], const char
                 c2 = 13;
             break;
         }
-        int has_entries = 0;
-        for (int year = first; year <= last; ++year) {
-            if (cal_class[year - first] == c || cal_class[year - first] == c2) {
-                printf("%5d", year);
-                has_entries = 1;
-            }
+        int a1 = (c % 7 + first_weekday) % 7 + (c >= 7 ? 7 : 0);
+        int a2 = c2 < 0 ? -1 : (c2 % 7 + first_weekday) % 7 + (c2 >= 7 ? 7 : 0);
+        if (print_years(first, last, a1, a2))
+            putchar('\n');
+    }
+}
+
+static int parse_year(const char *s, long long *year)
+{
+    char *end;
+    errno = 0;
+    *year = strtoll(s, &end, 10);
+    return errno == 0 && end != s && *end == '\0';
+}
+
+static void print_year_or_dash(long long year, long long distance, int ok)
+{
+    if (ok)
+        printf(" %lld", year + distance);
+    else
+        fputs(" -", stdout);
+}
+
+/* Answers one query per input line in constant time. A line too long
+   for the buffer is read to its end and answered once, as invalid. */
+static void answer_queries(int with_easter)
+{
+    char line[64];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        int too_long = strchr(line, '\n') == NULL && !feof(stdin);
+        if (too_long) {
+            int ch;
+            while ((ch = getchar()) != EOF && ch != '\n')
+                ;
         }
-        if (has_entries)
+        line[strcspn(line, " \t\r\n")] = '\0';
+        if (line[0] == '\0' && !too_long)
+            continue;
+        long long year;
+        if (too_long || !parse_year(line, &year) || year < 1583) {
+            printf("%s invalid\n", line);
+        } else {
+            long long prev, next;
+            if (with_easter) {
+                prev = easter_prev[year % EASTER_CYCLE];
+                next = easter_next[year % EASTER_CYCLE];
+            } else {
+                prev = class_prev[year % CYCLE];
+                next = class_next[year % CYCLE];
+            }
+            printf("%lld", year);
+            print_year_or_dash(year, -prev, year - prev >= 1583);
+            print_year_or_dash(year, next, year <= LLONG_MAX - next);
             putchar('\n');
+        }
+        fflush(stdout);
     }
 }
 
@@ -59,34 +250,53 @@ int main(int argc, char *argv[])
         progname = ptmp + 1;
 #endif
 
+    int query = 0, with_easter = 0;
+    while (argc > 1 && argv[1][0] == '-' && argv[1][1] != '\0'
+           && strspn(argv[1] + 1, "eq") == strlen(argv[1] + 1)) {
+        query |= strchr(argv[1], 'q') != NULL;
+        with_easter |= strchr(argv[1], 'e') != NULL;
+        --argc;
+        ++argv;
+    }
+
+    if (query) {
+        if (argc != 1) {
+            fprintf(stderr, "%s: option -q reads the years from stdin\n", progname);
+            return EXIT_FAILURE;
+        }
+        init_cycle_table();
+        build_distances(CYCLE, NULL, class_prev, class_next);
+        if (with_easter && !init_easter_table()) {
+            fprintf(stderr, "%s: not enough memory for the Easter tables\n", progname);
+            return EXIT_FAILURE;
+        }
+        answer_queries(with_easter);
+        return EXIT_SUCCESS;
+    }
+    if (with_easter) {
+        fprintf(stderr, "%s: option -e needs option -q\n", progname);
+        return EXIT_FAILURE;
+    }
+
     if (argc != 3) {
         fprintf(stderr, "%s: needs two arguments\n", progname);
         return EXIT_FAILURE;
     }
 
-    int first = atoi(argv[1]);
-    int last  = atoi(argv[2]);
-
-    if (first < 1583 || last < first || last >= 10000) {
-        fprintf(stderr, "%s: arguments must be years from 1583 to 9999\n", progname);
+    long long first, last;
+    if (!parse_year(argv[1], &first) || !parse_year(argv[2], &last)
+        || first < 1583 || last < first) {
+        fprintf(stderr, "%s: arguments must be years from 1583 to %lld\n",
+                progname, LLONG_MAX);
         return EXIT_FAILURE;
     }
 
-    int cal_class[last - first + 1];
-    int c = 0;
-    for (int year = first; year <= last; ++year) {
-        cal_class[year - first] = c;
-        if (is_leap_year(year)) {
-            cal_class[year - first] += 7;
-            ++c;
-        }
-        c = (c + 1) % 7;
-    }
+    init_cycle_table();
 
-    printf("Reusable calendars for years from %d to %d\n\n", first, last);
-    print_case(1, first, last, cal_class, "whole years");
-    print_case(2, first, last, cal_class, "January 1st until February 28th");
-    print_case(3, first, last, cal_class, "March until December");
+    printf("Reusable calendars for years from %lld to %lld\n\n", first, last);
+    print_case(1, first, last, "whole years");
+    print_case(2, first, last, "January 1st until February 28th");
+    print_case(3, first, last, "March until December");
 
     return EXIT_SUCCESS;
 }
@@ -1,26 +1,246 @@
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 
-int main(void)
+/* Prints the current time, or with option -f prefixes every line read
+ * from stdin with the time it arrived.
+ *
+ * Besides the strftime() conversions the format may contain one of %3N,
+ * %6N or %9N (%N) for milliseconds, microseconds or nanoseconds. The format
+ * is only converted by strftime() when the second changes, the fraction
+ * of the second is written into the converted text for every line. */
+
+#define DEFAULT_FORMAT  "%a %d. %b %Y %H:%M:%S %Z"
+#define MILLI_FORMAT    "%a %d. %b %Y %H:%M:%S.%3N %Z"
+#define MICRO_FORMAT    "%a %d. %b %Y %H:%M:%S.%6N %Z"
+
+#define STAMP_SIZE      256
+#define IN_SIZE         65536
+#define OUT_SIZE        1048576
+
+static char head_format[STAMP_SIZE], tail_format[STAMP_SIZE];
+static int fraction_digits = 0;         /* 0 if there is no %N */
+static char stamp[2 * STAMP_SIZE + 16];
+static size_t stamp_length;
+static size_t fraction_pos;
+static time_t stamp_second = -1;
+
+static char in_buffer[IN_SIZE];
+static char out_buffer[OUT_SIZE];
+static size_t out_length = 0;
+
+static void usage(void)
 {
-    const size_t buffer_size = 80;
-    char s[buffer_size];
-    time_t current_time = time(NULL);
-    struct tm *local;
+    (void) fprintf(stderr, "usage: tm [-f] [-m|-u] [-F format]\n"
+                           "  -f   filter, prefix every line of stdin with the time\n"
+                           "  -F   strftime() format, %%3N/%%6N/%%9N for fractions of a second\n"
+                           "  -m   show milliseconds\n"
+                           "  -u   show microseconds\n");
+}
 
-    if (current_time == ((time_t)-1)) {
-        (void) fprintf(stderr, "Failure to obtain the current time.\n");
+/* Splits the format at the fraction conversion, if there is one. */
+static void split_format(const char *format)
+{
+    size_t i, token_length = 0;
+    for (i = 0; format[i] != '\0'; ++i) {
+        if (format[i] != '%')
+            continue;
+        if (format[i+1] == '%') {
+            ++i;
+        } else if (format[i+1] == 'N') {
+            fraction_digits = 9;
+            token_length = 2;
+            break;
+        } else if ((format[i+1] == '3' || format[i+1] == '6' || format[i+1] == '9')
+                   && format[i+2] == 'N') {
+            fraction_digits = format[i+1] - '0';
+            token_length = 3;
+            break;
+        }
+    }
+    if (i >= STAMP_SIZE || strlen(format + i) >= STAMP_SIZE) {
+        (void) fprintf(stderr, "Format too long.\n");
         exit(EXIT_FAILURE);
     }
+    memcpy(head_format, format, i);
+    head_format[i] = '\0';
+    if (fraction_digits > 0)
+        strcpy(tail_format, format + i + token_length);
+}
 
-    local = localtime(&current_time);
-    size_t chars = strftime(s, buffer_size, "%a %d. %b %Y %H:%M:%S %Z", local);
-    if (chars == 0) {
+static size_t convert(char *s, const char *format, const struct tm *local)
+{
+    size_t chars = strftime(s, STAMP_SIZE, format, local);
+    if (chars == 0 && format[0] != '\0') {
         (void) fprintf(stderr, "Conversion failure, internal buffer too small.\n");
         exit(EXIT_FAILURE);
+    }
+    return chars;
+}
+
+/* Brings the stamp up to date for the given time. */
+static void update_stamp(const struct timespec *ts)
+{
+    if (ts->tv_sec != stamp_second) {
+        struct tm local;
+        stamp_second = ts->tv_sec;
+        localtime_r(&stamp_second, &local);
+        fraction_pos = convert(stamp, head_format, &local);
+        stamp_length = fraction_pos;
+        if (fraction_digits > 0) {
+            stamp_length += fraction_digits;
+            stamp_length += convert(stamp + stamp_length, tail_format, &local);
+        }
+    }
+    if (fraction_digits > 0) {
+        long fraction = ts->tv_nsec;
+        int i;
+        for (i = fraction_digits; i < 9; ++i)
+            fraction /= 10;
+        for (i = fraction_digits; --i >= 0; fraction /= 10)
+            stamp[fraction_pos + i] = '0' + fraction % 10;
+    }
+}
+
+static void get_time(struct timespec *ts)
+{
+    if (clock_gettime(CLOCK_REALTIME, ts) != 0) {
+        (void) fprintf(stderr, "Failure to obtain the current time.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void write_all(const char *s, size_t length)
+{
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = write(STDOUT_FILENO, s + done, length - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EPIPE)
+                (void) fprintf(stderr, "Write error (%s).\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        done += n;
+    }
+}
+
+static void flush_output(void)
+{
+    write_all(out_buffer, out_length);
+    out_length = 0;
+}
+
+static void output(const char *s, size_t n)
+{
+    if (out_length + n > OUT_SIZE)
+        flush_output();
+    if (n > OUT_SIZE) {
+        write_all(s, n);
+    } else {
+        memcpy(out_buffer + out_length, s, n);
+        out_length += n;
+    }
+}
+
+/* Output is collected in a large buffer and only written when it is full
+ * or when no more input is waiting, so slow inputs are passed on at once. */
+static void filter(void)
+{
+    int at_line_start = 1;
+    for (;;) {
+        struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+        if (out_length > 0 && poll(&pfd, 1, 0) == 0)
+            flush_output();
+        ssize_t n = read(STDIN_FILENO, in_buffer, IN_SIZE);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            (void) fprintf(stderr, "Read error (%s).\n", strerror(errno));
+            flush_output();
+            exit(EXIT_FAILURE);
+        }
+        if (n == 0)
+            break;
+        const char *p = in_buffer, *end = in_buffer + n;
+        while (p < end) {
+            if (at_line_start) {
+                struct timespec ts;
+                get_time(&ts);
+                update_stamp(&ts);
+                output(stamp, stamp_length);
+                output(" ", 1);
+                at_line_start = 0;
+            }
+            const char *nl = memchr(p, '\n', end - p);
+            if (nl != NULL) {
+                output(p, nl + 1 - p);
+                p = nl + 1;
+                at_line_start = 1;
+            } else {
+                output(p, end - p);
+                p = end;
+            }
+        }
+    }
+    flush_output();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *format = DEFAULT_FORMAT;
+    int filter_mode = 0;
+
+    for (--argc, ++argv; argc > 0; --argc, ++argv) {
+        if (**argv != '-') {
+            usage();
+            return EXIT_FAILURE;
+        }
+        while (*++*argv) {
+            switch (**argv) {
+              case 'f':
+                filter_mode = 1;
+                break;
+              case 'F':
+                if (*++*argv || --argc && *++argv) {
+                    format = *argv;
+                } else {
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                goto nextarg;
+              case 'm':
+                format = MILLI_FORMAT;
+                break;
+              case 'u':
+                format = MICRO_FORMAT;
+                break;
+              case 'h':
+                usage();
+                return EXIT_SUCCESS;
+              default:
+                (void) fprintf(stderr, "Unknown command line flag '%c'.\n", **argv);
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+        nextarg: ;
+    }
+    split_format(format);
+
+    if (filter_mode) {
+        filter();
     } else {
-        (void) puts(s);
+        struct timespec ts;
+        get_time(&ts);
+        update_stamp(&ts);
+        stamp[stamp_length] = '\0';
+        (void) puts(stamp);
     }
     return EXIT_SUCCESS;
 }
@@ -1,25 +1,27 @@
 /* File: charstat.c */
 
-/* Version 0.1.1, Martin Titz, 2013 */
+/* Version 0.2, Martin Titz, 2013, 2026 */
 
 #include <ctype.h>
-#include <errno.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifndef BUFFER_SIZE
-#define BUFFER_SIZE 16384
-#endif
+#include "cache.h"
+#include "kernels.h"
+#include "reader.h"
+#include "stats.h"
 
 #ifndef PORTABLE
 #define GERMAN_UMLAUTS
 #endif
 
+#define CACHE_TOOL "charstat 2"    /* change when byteCount changes */
+
 static int verbose = 0;
 static int error_count = 0;
-static unsigned char buffer[BUFFER_SIZE];
+static int read_flags = READER_GUNZIP;
 static unsigned long byteCount[UCHAR_MAX+1];
 const static char otherPrintableChars[] = {
     '!', '"', '#', '$', '%', '&', '?', '(', ')', '*',
@@ -34,7 +36,8 @@ static const char *const progname = "charstat";
 
 static void usage(void)
 {
-    fprintf(stderr, "usage: %s [-v] [file]...\n", progname);
+    fprintf(stderr, "usage: %s [-D] [-v] [-Z] [--cache[=list|compact|purge]] [--cpu=level]\n"
+                    "       [--stats[=json]] [file]...\n", progname);
 }
 
 #ifdef UNUSED
@@ -167,37 +170,69 @@ static void printByteCount()
     }
 }
 
-static void do_handle(FILE *f)
+static void do_handle(struct reader *r)
 {
+    const unsigned char *block;
+    size_t bytes_read;
+
     resetByteCount();
-    for (;;) {
-        size_t bytes_read = fread(buffer, 1, BUFFER_SIZE, f);
-        size_t i;
-        for (i = 0; i < bytes_read; ++i) {
-            ++byteCount[buffer[i]];
-        }
-        if (bytes_read < BUFFER_SIZE)
-            break;
-    }
-    if (ferror(f)) {
-        fprintf(stderr, "%s: read error (%s)\n", progname, strerror(errno));
+    while ((bytes_read = reader_next(r, &block)) > 0)
+        kernels.histogram(block, bytes_read, byteCount);
+    if (r->error)
         ++error_count;
+    printByteCount();
+}
+
+/* Results of compressed files differ with decompression. */
+static const char *cache_options(void)
+{
+    return (read_flags & READER_GUNZIP) && reader_gunzip ? "z" : "";
+}
+
+/* The counts of an unchanged file from the cache, without reading it. */
+static int do_cached(const char *fname, const struct stat *st)
+{
+    size_t size;
+    void *data = cache_get(st, CACHE_TOOL, cache_options(), &size);
+
+    if (data == NULL)
+        return 0;
+    if (size != sizeof(byteCount)) {
+        free(data);
+        return 0;
     }
+    memcpy(byteCount, data, sizeof(byteCount));
+    free(data);
+    printf("\nFile %s:\n\n", fname);
     printByteCount();
+    return 1;
 }
 
 static void do_file(const char *fname)
 {
-    FILE *f;
-    if ((f = fopen(fname, "rb")) == 0) {
-        fprintf(stderr, "%s: can't open %s (%s)\n",
-                progname, fname, strerror(errno));
+    struct reader r;
+    struct stat st;
+    int cacheable = cache_enabled && stat(fname, &st) == 0 && S_ISREG(st.st_mode);
+
+    if (cacheable && do_cached(fname, &st))
+        return;
+    if (reader_open(&r, fname, read_flags) != 0) {
         ++error_count;
         return;
     }
     printf("\nFile %s:\n\n", fname);
-    do_handle(f);
-    fclose(f);
+    do_handle(&r);
+    if (cacheable && !r.error)
+        cache_put(fname, &st, CACHE_TOOL, cache_options(), byteCount, sizeof(byteCount));
+    reader_close(&r);
+}
+
+static void do_stdin(void)
+{
+    struct reader r;
+    reader_stdin(&r, read_flags);
+    do_handle(&r);
+    reader_close(&r);
 }
 
 int main(int argc, char *argv[])
@@ -210,19 +245,27 @@ int main(int argc, char *argv[])
     if (ptmp = strrchr(progname, '/'))
         progname = ptmp + 1;
 #endif
+    reader_progname = progname;
+    kernels_level();
     for (--argc, ++argv;  argc > 0;  --argc, ++argv) {
         if (**argv == '-' && do_opts) {
+            if (stats_option(*argv, progname) || kernels_option(*argv, progname)
+                || cache_option(*argv, progname))
+                continue;
             if (argv[0][1] == 0) {
                 if (files_done)
                     puts("");
                 if (verbose)
                     puts("\nstdin:\n");
-                do_handle(stdin);
+                do_stdin();
                 ++files_done;
                 continue;
             }
             while (*++*argv) {
                 switch (**argv) {
+                    case 'D':
+                        read_flags |= READER_DIRECT;
+                        break;
                     case 'h':
                     case '?':
                         usage();
@@ -230,6 +273,9 @@ int main(int argc, char *argv[])
                     case 'v':
                         ++verbose;
                         break;
+                    case 'Z':
+                        read_flags &= ~READER_GUNZIP;
+                        break;
                     case '-':
                         do_opts = 0;
                         break;
@@ -251,6 +297,6 @@ int main(int argc, char *argv[])
 #endif
     }
     if (!files_done)
-        do_handle(stdin);
+        do_stdin();
     return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -1,25 +1,65 @@
 /* File: contains.c */
 
-/* Version 1.0, Martin Titz, 2002 */
+/* Version 1.2, Martin Titz, 2002, 2026 */
 
 #include <errno.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef BUFSIZ
-#if BUFSIZ>0 && BUFSIZ%16==0
-#define BUFFER_SIZE BUFSIZ
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __unix__
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #endif
+
+#include "kernels.h"
+#include "reader.h"
+#include "stats.h"
+
+/* Needles longer than LARGE_NEEDLE bytes are searched for by a rolling
+   hash over their first HASH_BLOCK bytes instead of by Two-Way, so the
+   needle itself is only touched to verify candidates. */
+#ifndef LARGE_NEEDLE
+#define LARGE_NEEDLE 16777216
+#endif
+
+#ifndef HASH_BLOCK
+#define HASH_BLOCK 4096
 #endif
 
-#ifndef BUFFER_SIZE
-#define BUFFER_SIZE 4096
+/* Sampling distance of the skip index written by --build-index. */
+#ifndef INDEX_BLOCK
+#define INDEX_BLOCK 65536
 #endif
 
+#define INDEX_MAGIC   "CONTIDX\n"
+#define INDEX_SUFFIX  ".cidx"
+#define INDEX_VERSION 1
+
+static int all_matches = 0;
+static int substring = 0;
+static int use_index = 0;
+static int threads = 0;
 static int error_count = 0;
 static int verbose = 1;
-static unsigned char block1[BUFFER_SIZE], block2[BUFFER_SIZE];
+static int read_flags = READER_GUNZIP;
+
+/* Byte histogram of one input file, filled by count_file().  Four
+   partial tables are used so that runs of equal bytes do not serialize
+   on a single counter; they are summed up in histogram_total(). */
+struct histogram {
+    struct reader *r;
+    unsigned long count[4][UCHAR_MAX+1];
+};
+
+static struct histogram hist1, hist2;
 
 #ifdef __unix__
 static char *progname;
@@ -29,40 +69,156 @@ static const char *const progname = "contains";
 
 static void usage(void)
 {
-    fprintf(stderr, "usage: %s [OPTION]... FILE1 FILE2\n", progname);
+    fprintf(stderr, "usage: %s [OPTION]... FILE1 FILE2\n"
+		    "       %s [OPTION]... -p PAIRLIST\n"
+		    "       %s [OPTION]... -1 LIST1 -2 LIST2\n"
+		    "       %s --build-index FILE2\n", progname, progname, progname, progname);
+    fprintf(stderr, "  -a   with -s, report all matches instead of only the first\n"
+		    "  -D   read with direct I/O, bypassing the page cache\n"
+		    "  -i   use the skip index FILE2" INDEX_SUFFIX " built by --build-index\n"
+		    "  -j THREADS  threads of a batch run, default the number of CPUs\n"
+		    "  -p PAIRLIST batch: test the pairs FILE1<tab>FILE2, one per line\n"
+		    "  -1 LIST1 -2 LIST2  batch: test every file of LIST1 against every\n"
+		    "              file of LIST2, one name per line; - reads stdin\n"
+		    "  -q   quiet, only set the exit status\n"
+		    "  -s   FILE1 must be a contiguous substring of FILE2\n"
+		    "  -v   verbose, explain why FILE1 was rejected\n"
+		    "  -Z   compare gzip files as they are, without decompressing them\n"
+		    "  --cpu=level     scalar, sse2, avx2 or avx512 (list, check)\n"
+		    "  --stats[=json]  report time, I/O and memory use to stderr\n"
+	);
 }
 
-static size_t read_block(unsigned char buffer[], FILE *f)
+static void arg_err(char c)
 {
-    size_t bytes = fread(buffer, 1, BUFFER_SIZE, f);
-    if (ferror(f)) {
-	fprintf(stderr, "%s: read error (%s)\n", progname, strerror(errno));
-	++error_count;
-	bytes = 0;
+    fprintf(stderr, "%s: option -%c requires an argument.\n", progname, c);
+    usage();
+    exit(EXIT_FAILURE);
+}
+
+static void count_bytes(const unsigned char *p, size_t n,
+			unsigned long count[4][UCHAR_MAX+1])
+{
+    size_t i;
+    for (i = 0; i + 4 <= n; i += 4) {
+	++count[0][p[i]];
+	++count[1][p[i+1]];
+	++count[2][p[i+2]];
+	++count[3][p[i+3]];
+    }
+    for (; i < n; ++i)
+	++count[0][p[i]];
+}
+
+static void *count_file(void *arg)
+{
+    struct histogram *h = arg;
+    const unsigned char *block;
+    size_t bytes;
+
+    memset(h->count, 0, sizeof(h->count));
+    while ((bytes = reader_next(h->r, &block)) > 0)
+	count_bytes(block, bytes, h->count);
+    return 0;
+}
+
+static unsigned long histogram_total(const struct histogram *h, int c)
+{
+    return h->count[0][c] + h->count[1][c] + h->count[2][c] + h->count[3][c];
+}
+
+/* Cheap necessary condition: file1 can only be a subsequence of file2
+   if no byte value occurs more often in file1 than in file2. */
+static int histogram_compare(const char *filename1, const char *filename2)
+{
+    int c;
+    for (c = 0; c <= UCHAR_MAX; ++c) {
+	unsigned long n1 = histogram_total(&hist1, c);
+	unsigned long n2 = histogram_total(&hist2, c);
+	if (n1 > n2) {
+	    if (verbose > 1)
+		printf("Byte 0x%02x occurs %lu times in %s, but only %lu times in %s\n",
+		       c, n1, filename1, n2, filename2);
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+/* Counts both files concurrently and rewinds them afterwards.  Returns
+   0 if file1 cannot be part of file2, 1 if the full test is needed. */
+static int histogram_check(struct reader *r1, struct reader *r2,
+			   const char *filename1, const char *filename2)
+{
+#ifdef __unix__
+    pthread_t thread;
+    int threaded;
+#endif
+
+    hist1.r = r1;
+    hist2.r = r2;
+#ifdef __unix__
+    threaded = pthread_create(&thread, 0, count_file, &hist1) == 0;
+    if (!threaded)
+	count_file(&hist1);
+    count_file(&hist2);
+    if (threaded)
+	pthread_join(thread, 0);
+#else
+    count_file(&hist1);
+    count_file(&hist2);
+#endif
+    if (r1->error || r2->error)
+	return 0;
+    if (!histogram_compare(filename1, filename2))
+	return 0;
+    return reader_rewind(r1) == 0 && reader_rewind(r2) == 0;
+}
+
+/* Rejects file1 without reading any data if it is larger than file2,
+   then runs the histogram pre-pass.  Both tests need regular files,
+   other inputs (pipes, devices) go directly to the full test. */
+static int quick_check(struct reader *r1, struct reader *r2,
+		       const char *filename1, const char *filename2)
+{
+    if (!r1->regular || !r2->regular)
+	return 1;
+    if (r1->size > r2->size) {
+	if (verbose > 1)
+	    printf("File %s is larger than %s\n", filename1, filename2);
+	return 0;
     }
-    return bytes;
+    return histogram_check(r1, r2, filename1, filename2);
 }
 
-static int contains(FILE *f1, FILE *f2)
+static int contains(struct reader *r1, struct reader *r2)
 {
+    const unsigned char *block1, *block2;
     size_t bytes1, bytes2;
     size_t c1, c2;
 
-    bytes2 = read_block(block2, f2);
+    bytes2 = reader_next(r2, &block2);
     c2 = 0;
-    while ((bytes1 = read_block(block1, f1)) > 0) {
+    while ((bytes1 = reader_next(r1, &block1)) > 0) {
 	c1 = 0;
 	while (c1 < bytes1) {
 	    /* trying to find character block1[c1] in file2,
 	       starting with position block2[c2] */
-	    do {
+	    for (;;) {
+		const unsigned char *hit;
 		if (c2 >= bytes2) {
-		    bytes2 = read_block(block2, f2);
+		    bytes2 = reader_next(r2, &block2);
 		    c2 = 0;
 		    if (bytes2 == 0)
 			return 0;	/* reached eof or error */
 		}
-	    } while (block1[c1] != block2[c2++]);
+		hit = kernels.find_byte(block2 + c2, block2 + bytes2, block1[c1]);
+		c2 = hit - block2;
+		if (c2 < bytes2) {
+		    ++c2;
+		    break;
+		}
+	    }
 
 	    /* next character of file1 */
 	    ++c1;
@@ -71,27 +227,829 @@ static int contains(FILE *f1, FILE *f2)
     return 1;
 }
 
+#ifdef __unix__
+/* Substring mode: both files are mapped into memory, so the search
+   needs no buffers of its own and its memory use does not depend on
+   the length of FILE1. */
+
+/* Called by the search functions for every match; the search stops
+   unless it returns nonzero. */
+typedef int (*match_func)(ptrdiff_t offset, void *context);
+
+struct file_names {
+    const char *filename1;
+    const char *filename2;
+};
+
+/* Only with -a and output enabled the search goes on after a match. */
+static int report_match(ptrdiff_t offset, void *context)
+{
+    const struct file_names *names = context;
+    if (verbose)
+	printf("File %s is part of %s at offset %ld\n",
+	       names->filename1, names->filename2, (long)offset);
+    return all_matches && verbose;
+}
+
+/* Maximal suffix of x[0..m-1] for the ordering selected by rev, as
+   needed for the critical factorization of Two-Way. */
+static ptrdiff_t max_suffix(const unsigned char *x, ptrdiff_t m,
+			    ptrdiff_t *period, int rev)
+{
+    ptrdiff_t ms = -1, j = 0, k = 1, p = 1;
+    while (j + k < m) {
+	unsigned char a = x[j + k];
+	unsigned char b = x[ms + k];
+	if (rev ? a > b : a < b) {
+	    j += k;
+	    k = 1;
+	    p = j - ms;
+	} else if (a == b) {
+	    if (k != p) {
+		++k;
+	    } else {
+		j += p;
+		k = 1;
+	    }
+	} else {
+	    ms = j;
+	    j = ms + 1;
+	    k = p = 1;
+	}
+    }
+    *period = p;
+    return ms;
+}
+
+/* Two-Way string matching (Crochemore and Perrin), constant extra
+   space and linear time.  Returns the number of matches found. */
+static unsigned long two_way(const unsigned char *x, ptrdiff_t m,
+			     const unsigned char *y, ptrdiff_t n,
+			     match_func match, void *context)
+{
+    ptrdiff_t i, j, ell, memory, per, p, q;
+    unsigned long found = 0;
+
+    i = max_suffix(x, m, &p, 0);
+    j = max_suffix(x, m, &q, 1);
+    if (i > j) {
+	ell = i;
+	per = p;
+    } else {
+	ell = j;
+	per = q;
+    }
+    if (memcmp(x, x + per, ell + 1) == 0) {
+	/* periodic needle */
+	j = 0;
+	memory = -1;
+	while (j <= n - m) {
+	    i = (ell > memory ? ell : memory) + 1;
+	    while (i < m && x[i] == y[i + j])
+		++i;
+	    if (i >= m) {
+		i = ell;
+		while (i > memory && x[i] == y[i + j])
+		    --i;
+		if (i <= memory) {
+		    ++found;
+		    if (!match(j, context))
+			break;
+		}
+		j += per;
+		memory = m - per - 1;
+	    } else {
+		j += i - ell;
+		memory = -1;
+	    }
+	}
+    } else {
+	per = (ell + 1 > m - ell - 1 ? ell + 1 : m - ell - 1) + 1;
+	j = 0;
+	while (j <= n - m) {
+	    i = ell + 1;
+	    while (i < m && x[i] == y[i + j])
+		++i;
+	    if (i >= m) {
+		i = ell;
+		while (i >= 0 && x[i] == y[i + j])
+		    --i;
+		if (i < 0) {
+		    ++found;
+		    if (!match(j, context))
+			break;
+		}
+		j += per;
+	    } else {
+		j += i - ell;
+	    }
+	}
+    }
+    return found;
+}
+
+/* Karp-Rabin over the first HASH_BLOCK bytes of a large needle, with
+   arithmetic modulo 2^64.  Candidates are verified against the whole
+   needle. */
+static unsigned long rolling_hash(const unsigned char *x, ptrdiff_t m,
+				  const unsigned char *y, ptrdiff_t n,
+				  match_func match, void *context)
+{
+    const uint64_t base = 0x100000001b3ULL;
+    const ptrdiff_t k = HASH_BLOCK < m ? HASH_BLOCK : m;
+    uint64_t hx = 0, hy = 0, top = 1;
+    unsigned long found = 0;
+    ptrdiff_t i, j;
+
+    if (n < m)
+	return 0;
+    for (i = 0; i < k; ++i) {
+	hx = hx * base + x[i];
+	hy = hy * base + y[i];
+	if (i > 0)
+	    top *= base;
+    }
+    for (j = 0; j <= n - m; ++j) {
+	if (hx == hy && memcmp(x, y + j, m) == 0) {
+	    ++found;
+	    if (!match(j, context))
+		break;
+	}
+	hy = (hy - y[j] * top) * base + y[j + k];
+    }
+    return found;
+}
+
+/* The whole file in memory, mapped by the reader or decompressed.
+   Valid until the reader is closed. */
+static const unsigned char *map_file(struct reader *r, const char *fname, size_t *size)
+{
+    if (!r->regular && !r->compressed) {
+	fprintf(stderr, "%s: %s is not a regular file\n", progname, fname);
+	++error_count;
+	return 0;
+    }
+    return reader_all(r, size);
+}
+
+static int contains_substring(struct reader *r1, struct reader *r2,
+			      const char *filename1, const char *filename2)
+{
+    const unsigned char *x, *y;
+    size_t m, n;
+    unsigned long found = 0;
+    struct file_names names;
+
+    if ((x = map_file(r1, filename1, &m)) == 0)
+	return 0;
+    if ((y = map_file(r2, filename2, &n)) == 0)
+	return 0;
+    names.filename1 = filename1;
+    names.filename2 = filename2;
+    if (m == 0) {
+	report_match(0, &names);
+	found = 1;
+    } else if (m <= n) {
+	found = m > LARGE_NEEDLE
+	      ? rolling_hash(x, m, y, n, report_match, &names)
+	      : two_way(x, m, y, n, report_match, &names);
+    }
+    return found > 0;
+}
+#endif
+
+#ifdef __unix__
+/* Skip index of a reference file.  Row k of the table holds for every
+   byte value c the position of the first c at or after k * block_size,
+   or ref_size if there is none.  A subsequence test then needs one
+   table lookup and at most one byte search within a block per byte of
+   FILE1.  The header binds the index to size, inode and modification
+   time of the reference file and also keeps its byte histogram. */
+struct index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t ref_size;
+    uint64_t ref_ino;
+    int64_t ref_mtime_sec;
+    int64_t ref_mtime_nsec;
+    uint64_t blocks;
+    uint64_t count[UCHAR_MAX+1];
+    uint64_t table_checksum;
+    uint64_t header_checksum;
+};
+
+struct skip_index {
+    const struct index_header *header;
+    const uint64_t *next;
+    size_t map_size;
+};
+
+/* FNV-1a over 64-bit words, the tail is processed bytewise. */
+static uint64_t checksum(const void *data, size_t n)
+{
+    const unsigned char *p = data;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    uint64_t w;
+    for (; n >= sizeof(w); n -= sizeof(w), p += sizeof(w)) {
+	memcpy(&w, p, sizeof(w));
+	h = (h ^ w) * 0x100000001b3ULL;
+    }
+    for (; n > 0; --n, ++p)
+	h = (h ^ *p) * 0x100000001b3ULL;
+    return h;
+}
+
+static char *index_name(const char *fname)
+{
+    char *name = malloc(strlen(fname) + sizeof(INDEX_SUFFIX));
+    if (name == 0) {
+	fprintf(stderr, "%s: out of memory\n", progname);
+	exit(EXIT_FAILURE);
+    }
+    strcpy(name, fname);
+    strcat(name, INDEX_SUFFIX);
+    return name;
+}
+
+static void index_identity(struct index_header *h, const struct stat *st)
+{
+    h->ref_size = st->st_size;
+    h->ref_ino = st->st_ino;
+    h->ref_mtime_sec = st->st_mtim.tv_sec;
+    h->ref_mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+static int build_index(const char *fname)
+{
+    static struct index_header h;
+    const unsigned char *p;
+    uint64_t *table;
+    struct reader r;
+    size_t n, k, table_size;
+    char *iname, *tmpname;
+    FILE *f;
+    int ok;
+
+    if (reader_open(&r, fname, read_flags & READER_GUNZIP) != 0) {
+	++error_count;
+	return 0;
+    }
+    if (r.compressed) {
+	/* the index would describe the compressed bytes */
+	fprintf(stderr, "%s: can't index %s, it is compressed\n", progname, fname);
+	++error_count;
+	reader_close(&r);
+	return 0;
+    }
+    if ((p = map_file(&r, fname, &n)) == 0) {
+	if (r.error)
+	    ++error_count;
+	reader_close(&r);
+	return 0;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+    h.version = INDEX_VERSION;
+    h.block_size = INDEX_BLOCK;
+    index_identity(&h, &r.st);
+    h.blocks = (n + INDEX_BLOCK - 1) / INDEX_BLOCK;
+    table_size = h.blocks * (UCHAR_MAX+1) * sizeof(uint64_t);
+    if ((table = malloc(table_size + 1)) == 0) {
+	fprintf(stderr, "%s: out of memory\n", progname);
+	exit(EXIT_FAILURE);
+    }
+
+    /* first occurrences within each block, then propagated backwards */
+    for (k = 0; k < h.blocks; ++k) {
+	uint64_t *row = table + k * (UCHAR_MAX+1);
+	size_t pos = k * INDEX_BLOCK;
+	size_t end = pos + INDEX_BLOCK < n ? pos + INDEX_BLOCK : n;
+	int c;
+	for (c = 0; c <= UCHAR_MAX; ++c)
+	    row[c] = n;
+	for (; pos < end; ++pos) {
+	    c = p[pos];
+	    ++h.count[c];
+	    if (row[c] == n)
+		row[c] = pos;
+	}
+    }
+    for (k = h.blocks; k-- > 1; ) {
+	const uint64_t *row = table + k * (UCHAR_MAX+1);
+	uint64_t *prev = table + (k-1) * (UCHAR_MAX+1);
+	int c;
+	for (c = 0; c <= UCHAR_MAX; ++c) {
+	    if (prev[c] == n)
+		prev[c] = row[c];
+	}
+    }
+    h.table_checksum = checksum(table, table_size);
+    h.header_checksum = checksum(&h, offsetof(struct index_header, header_checksum));
+    reader_close(&r);
+
+    /* written under a temporary name, so readers never see half an index */
+    iname = index_name(fname);
+    tmpname = malloc(strlen(iname) + 5);
+    if (tmpname == 0) {
+	fprintf(stderr, "%s: out of memory\n", progname);
+	exit(EXIT_FAILURE);
+    }
+    sprintf(tmpname, "%s.tmp", iname);
+    ok = 0;
+    if ((f = fopen(tmpname, "wb")) == 0) {
+	fprintf(stderr, "%s: can't create %s (%s)\n",
+		progname, tmpname, strerror(errno));
+    } else {
+	ok = fwrite(&h, sizeof(h), 1, f) == 1
+	     && fwrite(table, 1, table_size, f) == table_size;
+	if (fclose(f) != 0)
+	    ok = 0;
+	if (!ok || rename(tmpname, iname) != 0) {
+	    fprintf(stderr, "%s: can't write %s (%s)\n",
+		    progname, iname, strerror(errno));
+	    remove(tmpname);
+	    ok = 0;
+	}
+    }
+    if (ok && verbose)
+	printf("Index of %s written to %s (%lu blocks)\n",
+	       fname, iname, (unsigned long)h.blocks);
+    if (!ok)
+	++error_count;
+    free(tmpname);
+    free(iname);
+    free(table);
+    return ok;
+}
+
+/* Maps the index of the reference file open in r.  Returns 0 if there
+   is no usable index: missing, of another version, damaged, or stale
+   because the reference file has changed since it was built. */
+static int load_index(const struct reader *r, const char *fname, struct skip_index *ix)
+{
+    const struct index_header *h;
+    struct index_header expected;
+    struct stat ist;
+    char *iname = index_name(fname);
+    const char *problem = 0;
+    int fd;
+    void *p;
+
+    memset(ix, 0, sizeof(*ix));
+    if ((fd = open(iname, O_RDONLY)) < 0) {
+	fprintf(stderr, "%s: can't open index %s (%s)\n",
+		progname, iname, strerror(errno));
+	free(iname);
+	return 0;
+    }
+    if (fstat(fd, &ist) != 0 || (size_t)ist.st_size < sizeof(*h)) {
+	problem = "truncated";
+    } else if ((p = mmap(0, ist.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+	       == MAP_FAILED) {
+	problem = strerror(errno);
+    } else {
+	ix->header = h = p;
+	ix->next = (const uint64_t *)(h + 1);
+	ix->map_size = ist.st_size;
+	memset(&expected, 0, sizeof(expected));
+	if (S_ISREG(r->st.st_mode))
+	    index_identity(&expected, &r->st);
+	if (r->compressed)
+	    problem = "reference is compressed";
+	else if (memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) != 0)
+	    problem = "not an index file";
+	else if (h->version != INDEX_VERSION)
+	    problem = "wrong version";
+	else if (h->header_checksum != checksum(h, offsetof(struct index_header, header_checksum)))
+	    problem = "bad header checksum";
+	else if (h->block_size == 0
+		 || h->blocks != (h->ref_size + h->block_size - 1) / h->block_size
+		 || ix->map_size != sizeof(*h) + h->blocks * (UCHAR_MAX+1) * sizeof(uint64_t))
+	    problem = "truncated";
+	else if (h->ref_size != expected.ref_size || h->ref_ino != expected.ref_ino
+		 || h->ref_mtime_sec != expected.ref_mtime_sec
+		 || h->ref_mtime_nsec != expected.ref_mtime_nsec)
+	    problem = "stale";
+	else if (h->table_checksum != checksum(ix->next, ix->map_size - sizeof(*h)))
+	    problem = "bad table checksum";
+	if (problem) {
+	    munmap(p, ix->map_size);
+	    memset(ix, 0, sizeof(*ix));
+	}
+    }
+    close(fd);
+    if (problem)
+	fprintf(stderr, "%s: index %s not used (%s)\n", progname, iname, problem);
+    free(iname);
+    return problem == 0;
+}
+
+/* Subsequence test of r1 against the mapped reference file y, jumping
+   through the reference with the skip index. */
+static int contains_indexed(struct reader *r1, const unsigned char *y,
+			    const struct skip_index *ix)
+{
+    const uint64_t n = ix->header->ref_size;
+    const uint64_t block_size = ix->header->block_size;
+    const uint64_t blocks = ix->header->blocks;
+    const unsigned char *block1;
+    uint64_t pos = 0;
+    size_t bytes1, c1;
+
+    while ((bytes1 = reader_next(r1, &block1)) > 0) {
+	for (c1 = 0; c1 < bytes1; ++c1) {
+	    const int c = block1[c1];
+	    const uint64_t k = pos / block_size;
+	    uint64_t q;
+	    if (pos >= n)
+		return 0;
+	    if (pos % block_size == 0) {
+		q = ix->next[k * (UCHAR_MAX+1) + c];
+	    } else {
+		const uint64_t end = (k+1) * block_size < n ? (k+1) * block_size : n;
+		const unsigned char *hit = kernels.find_byte(y + pos, y + end, c);
+		if (hit < y + end)
+		    q = hit - y;
+		else
+		    q = k+1 < blocks ? ix->next[(k+1) * (UCHAR_MAX+1) + c] : n;
+	    }
+	    if (q >= n)
+		return 0;
+	    pos = q + 1;
+	}
+    }
+    return 1;
+}
+
+/* Returns -1 if no usable index exists, so the caller falls back to
+   the plain scan. */
+static int contains_with_index(struct reader *r1, struct reader *r2,
+			       const char *filename1, const char *filename2)
+{
+    struct skip_index ix;
+    const unsigned char *y;
+    size_t n;
+    int c, result;
+
+    if (!load_index(r2, filename2, &ix))
+	return -1;
+    if (r1->regular) {
+	/* the histogram of the reference file is stored in the index */
+	if (r1->size > ix.header->ref_size) {
+	    if (verbose > 1)
+		printf("File %s is larger than %s\n", filename1, filename2);
+	    munmap((void *)ix.header, ix.map_size);
+	    return 0;
+	}
+	hist1.r = r1;
+	count_file(&hist1);
+	memset(hist2.count, 0, sizeof(hist2.count));
+	for (c = 0; c <= UCHAR_MAX; ++c)
+	    hist2.count[0][c] = ix.header->count[c];
+	if (r1->error || !histogram_compare(filename1, filename2)
+	    || reader_rewind(r1) != 0) {
+	    munmap((void *)ix.header, ix.map_size);
+	    return 0;
+	}
+    }
+    result = 0;
+    if ((y = map_file(r2, filename2, &n)) != 0) {
+	madvise((void *)y, n, MADV_RANDOM);
+	result = contains_indexed(r1, y, &ix);
+    }
+    munmap((void *)ix.header, ix.map_size);
+    return result;
+}
+#endif
+
+#ifdef __unix__
+/* Batch mode: every file named in the lists is read only once, shared
+   by all pairs it takes part in, and the pairs are tested by a pool of
+   threads.  Results are written as a table, one line per pair:
+       FILE1 <tab> FILE2 <tab> yes|no|error
+   and in substring mode the offset of the first match instead of yes. */
+
+#define BATCH_HASH_SIZE 4096
+
+struct batch_file {
+    char *name;
+    struct reader input;
+    const unsigned char *data;
+    size_t size;
+    int error;
+    unsigned long count[UCHAR_MAX+1];
+    struct batch_file *hash_next;
+};
+
+struct batch_pair {
+    struct batch_file *file1;
+    struct batch_file *file2;
+    long result;            /* -2 error, -1 no, else offset (0 for yes) */
+};
+
+static struct batch_file *batch_hash[BATCH_HASH_SIZE];
+static struct batch_file **batch_files;
+static size_t batch_file_count, batch_file_max;
+static struct batch_pair *batch_pairs;
+static size_t batch_pair_count, batch_pair_max;
+
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t next_job, job_count;
+static void (*job_func)(size_t);
+
+static void *xrealloc(void *p, size_t size)
+{
+    if ((p = realloc(p, size)) == 0) {
+	fprintf(stderr, "%s: out of memory\n", progname);
+	exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static struct batch_file *batch_file(const char *name)
+{
+    const unsigned char *s;
+    unsigned long h = 5381;
+    struct batch_file *f;
+
+    for (s = (const unsigned char *)name; *s; ++s)
+	h = h * 33 + *s;
+    h %= BATCH_HASH_SIZE;
+    for (f = batch_hash[h]; f; f = f->hash_next) {
+	if (strcmp(f->name, name) == 0)
+	    return f;
+    }
+    f = xrealloc(0, sizeof(*f));
+    memset(f, 0, sizeof(*f));
+    f->name = xrealloc(0, strlen(name) + 1);
+    strcpy(f->name, name);
+    f->hash_next = batch_hash[h];
+    batch_hash[h] = f;
+    if (batch_file_count == batch_file_max) {
+	batch_file_max = batch_file_max ? 2 * batch_file_max : 256;
+	batch_files = xrealloc(batch_files, batch_file_max * sizeof(*batch_files));
+    }
+    batch_files[batch_file_count++] = f;
+    return f;
+}
+
+static void batch_pair(const char *name1, const char *name2)
+{
+    if (batch_pair_count == batch_pair_max) {
+	batch_pair_max = batch_pair_max ? 2 * batch_pair_max : 256;
+	batch_pairs = xrealloc(batch_pairs, batch_pair_max * sizeof(*batch_pairs));
+    }
+    batch_pairs[batch_pair_count].file1 = batch_file(name1);
+    batch_pairs[batch_pair_count].file2 = batch_file(name2);
+    batch_pairs[batch_pair_count].result = -2;
+    ++batch_pair_count;
+}
+
+/* Reads a list file ("-" for stdin) and returns its lines, without
+   line ends and without empty lines.  *count receives their number. */
+static char **read_list(const char *fname, size_t *count)
+{
+    FILE *f = strcmp(fname, "-") == 0 ? stdin : fopen(fname, "r");
+    char **lines = 0;
+    size_t n = 0, max = 0;
+    char *line = 0;
+    size_t line_size = 0;
+    ssize_t len;
+
+    if (f == 0) {
+	fprintf(stderr, "%s: can't open %s (%s)\n",
+		progname, fname, strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+    while ((len = getline(&line, &line_size, f)) >= 0) {
+	while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+	    line[--len] = '\0';
+	if (len == 0)
+	    continue;
+	if (n == max) {
+	    max = max ? 2 * max : 256;
+	    lines = xrealloc(lines, max * sizeof(*lines));
+	}
+	lines[n] = xrealloc(0, len + 1);
+	memcpy(lines[n++], line, len + 1);
+    }
+    if (ferror(f)) {
+	fprintf(stderr, "%s: read error on %s (%s)\n",
+		progname, fname, strerror(errno));
+	exit(EXIT_FAILURE);
+    }
+    if (f != stdin)
+	fclose(f);
+    free(line);
+    *count = n;
+    return lines;
+}
+
+static void *job_worker(void *arg)
+{
+    for (;;) {
+	size_t job;
+	pthread_mutex_lock(&job_mutex);
+	job = next_job++;
+	pthread_mutex_unlock(&job_mutex);
+	if (job >= job_count)
+	    break;
+	job_func(job);
+    }
+    return arg;
+}
+
+/* Runs func(0) ... func(jobs-1) on the thread pool. */
+static void run_jobs(size_t jobs, void (*func)(size_t))
+{
+    pthread_t *pool;
+    int i, started;
+    int n = threads;
+
+    if (n <= 0) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	n = cpus > 0 ? (int)cpus : 1;
+    }
+    if ((size_t)n > jobs)
+	n = jobs > 0 ? (int)jobs : 1;
+    next_job = 0;
+    job_count = jobs;
+    job_func = func;
+    pool = xrealloc(0, n * sizeof(*pool));
+    for (started = 0; started < n; ++started) {
+	if (pthread_create(&pool[started], 0, job_worker, 0) != 0)
+	    break;
+    }
+    if (started == 0)
+	job_worker(0);
+    for (i = 0; i < started; ++i)
+	pthread_join(pool[i], 0);
+    free(pool);
+}
+
+/* Maps a regular file, reads anything else completely into memory,
+   and counts the bytes for the histogram rejection. */
+static void load_job(size_t i)
+{
+    struct batch_file *bf = batch_files[i];
+    unsigned long count[4][UCHAR_MAX+1];
+    int c;
+
+    if (reader_open(&bf->input, bf->name, read_flags) != 0
+	|| (bf->data = reader_all(&bf->input, &bf->size)) == 0) {
+	bf->error = 1;
+	return;
+    }
+    memset(count, 0, sizeof(count));
+    count_bytes(bf->data, bf->size, count);
+    for (c = 0; c <= UCHAR_MAX; ++c)
+	bf->count[c] = count[0][c] + count[1][c] + count[2][c] + count[3][c];
+}
+
+static int subsequence(const unsigned char *x, size_t m,
+		       const unsigned char *y, size_t n)
+{
+    size_t i, pos = 0;
+    for (i = 0; i < m; ++i) {
+	const unsigned char *hit;
+	if (pos >= n || (hit = kernels.find_byte(y + pos, y + n, x[i])) == y + n)
+	    return 0;
+	pos = hit - y + 1;
+    }
+    return 1;
+}
+
+static int first_match(ptrdiff_t offset, void *context)
+{
+    *(long *)context = offset;
+    return 0;
+}
+
+static void match_job(size_t i)
+{
+    struct batch_pair *bp = &batch_pairs[i];
+    const struct batch_file *f1 = bp->file1, *f2 = bp->file2;
+    int c;
+
+    if (f1->error || f2->error)
+	return;
+    bp->result = -1;
+    if (f1->size > f2->size)
+	return;
+    for (c = 0; c <= UCHAR_MAX; ++c) {
+	if (f1->count[c] > f2->count[c])
+	    return;
+    }
+    if (!substring) {
+	if (subsequence(f1->data, f1->size, f2->data, f2->size))
+	    bp->result = 0;
+    } else if (f1->size == 0) {
+	bp->result = 0;
+    } else if (f1->size > LARGE_NEEDLE) {
+	rolling_hash(f1->data, f1->size, f2->data, f2->size,
+		     first_match, &bp->result);
+    } else {
+	two_way(f1->data, f1->size, f2->data, f2->size,
+		first_match, &bp->result);
+    }
+}
+
+static int do_batch(const char *pairlist, const char *list1, const char *list2)
+{
+    size_t i, j, n1, n2;
+
+    if (pairlist) {
+	char **lines = read_list(pairlist, &n1);
+	for (i = 0; i < n1; ++i) {
+	    char *tab = strchr(lines[i], '\t');
+	    if (tab == 0) {
+		fprintf(stderr, "%s: %s: missing tab in line \"%s\"\n",
+			progname, pairlist, lines[i]);
+		++error_count;
+	    } else {
+		*tab = '\0';
+		batch_pair(lines[i], tab + 1);
+	    }
+	    free(lines[i]);
+	}
+	free(lines);
+    } else {
+	char **lines1 = read_list(list1, &n1);
+	char **lines2 = read_list(list2, &n2);
+	for (i = 0; i < n1; ++i) {
+	    for (j = 0; j < n2; ++j)
+		batch_pair(lines1[i], lines2[j]);
+	}
+	for (i = 0; i < n1; ++i)
+	    free(lines1[i]);
+	for (j = 0; j < n2; ++j)
+	    free(lines2[j]);
+	free(lines1);
+	free(lines2);
+    }
+
+    run_jobs(batch_file_count, load_job);
+    run_jobs(batch_pair_count, match_job);
+
+    for (i = 0; i < batch_file_count; ++i) {
+	if (batch_files[i]->error)
+	    ++error_count;
+    }
+    for (i = 0; i < batch_pair_count; ++i) {
+	const struct batch_pair *bp = &batch_pairs[i];
+	printf("%s\t%s\t", bp->file1->name, bp->file2->name);
+	if (bp->result == -2)
+	    puts("error");
+	else if (bp->result == -1)
+	    puts("no");
+	else if (substring)
+	    printf("%ld\n", bp->result);
+	else
+	    puts("yes");
+    }
+    return error_count == 0;
+}
+#endif
+
 static int do_files(const char *filename1, const char *filename2)
 {
-    FILE *file1, *file2;
+    struct reader r1, r2;
     int result;
 
-    if ((file1 = fopen(filename1, "rb")) == 0) {
-	fprintf(stderr, "%s: can't open %s (%s)\n",
-		progname, filename1, strerror(errno));
+    if (reader_open(&r1, filename1, read_flags) != 0) {
 	++error_count;
 	return 0;
     }
-    if ((file2 = fopen(filename2, "rb")) == 0) {
-	fprintf(stderr, "%s: can't open %s (%s)\n",
-		progname, filename2, strerror(errno));
+    if (reader_open(&r2, filename2, read_flags) != 0) {
 	++error_count;
-	fclose(file1);
+	reader_close(&r1);
 	return 0;
     }
-    result = contains(file1, file2);
-    fclose(file1);
-    fclose(file2);
+#ifdef __unix__
+    if (use_index && !substring
+	&& (result = contains_with_index(&r1, &r2, filename1, filename2)) >= 0) {
+	goto done;
+    }
+#endif
+    result = quick_check(&r1, &r2, filename1, filename2);
+#ifdef __unix__
+    if (result && substring)
+	result = contains_substring(&r1, &r2, filename1, filename2);
+    else
+#endif
+    if (result)
+	result = contains(&r1, &r2);
+#ifdef __unix__
+  done:
+#endif
+    if (r1.error || r2.error) {
+	++error_count;
+	result = 0;
+    }
+    reader_close(&r1);
+    reader_close(&r2);
     return result;
 }
 
@@ -99,27 +1057,82 @@ int main(int argc, char *argv[])
 {
     int do_opts = 1;
     int files_index = 0;
+    int index_mode = 0;
     char *fnames[2];
+    char *pairlist = 0, *list1 = 0, *list2 = 0;
 #ifdef __unix__
     char *ptmp;
     progname = argv[0];
     if (ptmp = strrchr(progname, '/'))
 	progname = ptmp + 1;
 #endif
+    reader_progname = progname;
+    kernels_level();		/* the batch threads share the table */
     for (--argc, ++argv;  argc > 0;  --argc, ++argv) {
 	if (**argv == '-' && do_opts) {
+	    if (stats_option(*argv, progname) || kernels_option(*argv, progname))
+		continue;
+#ifdef __unix__
+	    if (strcmp(*argv, "--build-index") == 0) {
+		index_mode = 1;
+		continue;
+	    }
+#endif
 	    while (*++*argv) {
 		switch (**argv) {
+		    case 'a':
+			all_matches = 1;
+			break;
+		    case 'D':
+			read_flags |= READER_DIRECT;
+			break;
 		    case 'h':
 		    case '?':
 			usage();
 			return EXIT_SUCCESS;
+#ifdef __unix__
+		    case 'i':
+			use_index = 1;
+			break;
+		    case 'j':
+			if (*++*argv || --argc && *++argv) {
+			    threads = atoi(*argv);
+			} else
+			    arg_err('j');
+			goto nextarg;
+		    case 'p':
+			if (*++*argv || --argc && *++argv) {
+			    pairlist = *argv;
+			} else
+			    arg_err('p');
+			goto nextarg;
+		    case '1':
+			if (*++*argv || --argc && *++argv) {
+			    list1 = *argv;
+			} else
+			    arg_err('1');
+			goto nextarg;
+		    case '2':
+			if (*++*argv || --argc && *++argv) {
+			    list2 = *argv;
+			} else
+			    arg_err('2');
+			goto nextarg;
+#endif
 		    case 'q':
 			verbose = 0;
 			break;
+#ifdef __unix__
+		    case 's':
+			substring = 1;
+			break;
+#endif
 		    case 'v':
 			++verbose;
 			break;
+		    case 'Z':
+			read_flags &= ~READER_GUNZIP;
+			break;
 		    case '-':
 			do_opts = 0;
 			break;
@@ -137,11 +1150,33 @@ int main(int argc, char *argv[])
 	    usage();
 	    return EXIT_FAILURE;
 	}
+	nextarg: ;
     }
-    if (files_index == 2) {
+    if (pairlist || list1 || list2) {
+#ifdef __unix__
+	if (files_index > 0 || !pairlist && (!list1 || !list2)
+	    || pairlist && (list1 || list2)) {
+	    fprintf(stderr, "%s: batch mode needs either -p or both -1 and -2,"
+		    " but no filenames.\n", progname);
+	    usage();
+	    return EXIT_FAILURE;
+	}
+	do_batch(pairlist, list1, list2);
+#endif
+    } else if (index_mode) {
+#ifdef __unix__
+	if (files_index != 1) {
+	    fprintf(stderr, "%s: --build-index needs exactly one filename.\n", progname);
+	    usage();
+	    return EXIT_FAILURE;
+	}
+	build_index(fnames[0]);
+#endif
+    } else if (files_index == 2) {
 	int result = do_files(fnames[0], fnames[1]);
 	if (error_count == 0) {
-	    if (verbose)
+	    /* matches in substring mode have already been reported */
+	    if (verbose && !(substring && result))
 		printf("File %s is%s part of %s\n", fnames[0],
 		       result ? "" : " not", fnames[1]);
 	    return result ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -1,6 +1,6 @@
 /* File: joinlines.c */
 
-/* Version 0.1.5, Martin Titz, 2013, 2014, 2016 */
+/* Version 0.2, Martin Titz, 2013, 2014, 2016, 2026 */
 
 #include <ctype.h>
 #include <errno.h>
@@ -12,9 +12,9 @@
 #include <unistd.h>
 #include <sys/types.h>
 
-#ifndef BUFFER_SIZE
-#define BUFFER_SIZE 16777216
-#endif
+#include "kernels.h"
+#include "reader.h"
+#include "stats.h"
 
 static int addPagebreaks = 0;
 static int ignoreEmptyLines = 0;
@@ -23,7 +23,6 @@ static int maxNewlines = 0;
 static int verbose = 0;
 static int error_count = 0;
 static int experimentalMode = 0;
-static unsigned char buffer[BUFFER_SIZE];
 #ifdef __unix__
 static char *progname;
 #else
@@ -32,7 +31,8 @@ static const char *const progname = "joinlines";
 
 static void usage(void)
 {
-    fprintf(stderr, "usage: %s [-E] [-l minLineLength] [-m maxNewlines] [-p] [-v] [file]...\n", progname);
+    fprintf(stderr, "usage: %s [-E] [-l minLineLength] [-m maxNewlines] [-p] [-v]\n"
+            "       [--cpu=level] [--stats[=json]] [file]...\n", progname);
     fprintf(stderr, "  -E   ignore empty lines\n"
                     "  -l   set minmal line length for joining\n"
                     "  -p   add pagebreaks\n"
@@ -52,7 +52,7 @@ static int noLinefeedExpected(unsigned char lastCh)
     return isalnum(lastCh) || lastCh == ',' || lastCh == ';' || lastCh == '%';
 }
 
-static void join_lines(FILE *file, size_t n)
+static void join_lines(FILE *file, const unsigned char *buffer, size_t n)
 {
     size_t i;
     int lfCount = 0;
@@ -60,15 +60,18 @@ static void join_lines(FILE *file, size_t n)
     int nlCount = 0;
     int lastLineLength = 0;
     unsigned char lastCh = '\0';  /* only for experimental mode */
-    for (i = 0; i < n; ++i) {
+    for (i = 0; i < n; ) {
         unsigned char ch = buffer[i];
         if (verbose >= 2)
             fprintf(stderr, " processing character %d\n", ch);
         if (ch == '\n') {
             ++lfCount;
+            ++i;
         } else if (ch == '\r') {
             ++crCount;
+            ++i;
         } else {
+            size_t run, k;
             if (lfCount > 0 && crCount > 0) {
                 nlCount = lfCount;
             } else if (lfCount > 0) {
@@ -106,12 +109,24 @@ static void join_lines(FILE *file, size_t n)
             } else {
                 ++lastLineLength;
             }
-            fputc(ch, file);
 
-            /* Set lastCh to last 'relevant' character, here ch cannot be LF or CR */
-            if (ch != ' ' && ch != '\t') {
-                lastCh = ch;
+            /* ch and the rest of the line are written at once */
+            run = kernels.find_eol(buffer + i + 1, buffer + n) - (buffer + i);
+            if (verbose >= 2) {
+                for (k = 1; k < run; ++k)
+                    fprintf(stderr, " processing character %d\n", buffer[i + k]);
+            }
+            fwrite(buffer + i, 1, run, file);
+            lastLineLength += (int)(run - 1);
+
+            /* Set lastCh to last 'relevant' character, here it cannot be LF or CR */
+            for (k = run; k > 0; --k) {
+                if (buffer[i + k - 1] != ' ' && buffer[i + k - 1] != '\t') {
+                    lastCh = buffer[i + k - 1];
+                    break;
+                }
             }
+            i += run;
         }
     }
     fputc('\n', file);
@@ -121,33 +136,13 @@ static void join_lines(FILE *file, size_t n)
     }
 }
 
-static void do_handle(FILE *file)
-{
-    size_t bytes_read = fread(buffer, 1, BUFFER_SIZE, file);
-    if (ferror(file)) {
-        fprintf(stderr, "%s: read error (%s)\n", progname, strerror(errno));
-        ++error_count;
-    } else if (feof(file)) {
-        if (file != stdin) {
-            /* Process bytes_read bytes stored in the buffer */
-            fseek(file, 0L, SEEK_SET);
-            if (ferror(file)) {
-                fprintf(stderr, "%s: seek error (%s)\n", progname, strerror(errno));
-                ++error_count;
-            } else {
-                join_lines(file, bytes_read);
-            }
-        } else {
-            join_lines(stdout, bytes_read);
-        }
-    } else {
-        fprintf(stderr, "%s: could not read until end of file.\n", progname);
-        ++error_count;
-    }
-}
-
+/* The file is rewritten in place, so its whole content is read into
+   memory first instead of being mapped. */
 static void do_file(const char *fname)
 {
+    const unsigned char *data;
+    struct reader r;
+    size_t n;
     FILE *file;
 
     if ((file = fopen(fname, "rb+")) == 0) {
@@ -159,10 +154,30 @@ static void do_file(const char *fname)
     if (verbose) {
         printf("\nFile %s:\n\n", fname);
     }
-    do_handle(file);
+    if (reader_open(&r, fname, READER_NOMAP) != 0
+        || (data = reader_all(&r, &n)) == 0) {
+        ++error_count;
+    } else {
+        join_lines(file, data, n);
+    }
+    reader_close(&r);
     fclose(file);
 }
 
+static void do_stdin(void)
+{
+    const unsigned char *data;
+    struct reader r;
+    size_t n;
+
+    reader_stdin(&r, 0);
+    if ((data = reader_all(&r, &n)) == 0)
+        ++error_count;
+    else
+        join_lines(stdout, data, n);
+    reader_close(&r);
+}
+
 int main(int argc, char *argv[])
 {
     int do_opts = 1;
@@ -173,14 +188,18 @@ int main(int argc, char *argv[])
     if (ptmp = strrchr(progname, '/'))
         progname = ptmp + 1;
 #endif
+    reader_progname = progname;
+    kernels_level();
     for (--argc, ++argv;  argc > 0;  --argc, ++argv) {
         if (**argv == '-' && do_opts) {
+            if (stats_option(*argv, progname) || kernels_option(*argv, progname))
+                continue;
             if (argv[0][1] == 0) {
                 if (files_done)
                     puts("");
                 if (verbose)
                     puts("\nstdin:\n");
-                do_handle(stdin);
+                do_stdin();
                 ++files_done;
                 continue;
             }
@@ -233,6 +252,6 @@ int main(int argc, char *argv[])
         nextarg: ;
     }
     if (!files_done)
-        do_handle(stdin);
+        do_stdin();
     return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
 }
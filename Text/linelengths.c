@@ -1,28 +1,27 @@
 /* File: linelengths.c */
 
-/* Version 0.1.4, Martin Titz, 2014 */
+/* Version 0.2, Martin Titz, 2014, 2026 */
 
-#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include <unistd.h>
-#include <sys/types.h>
-
-#ifndef BUFFER_SIZE
-#define BUFFER_SIZE 16777216
-#endif
+#include "cache.h"
+#include "kernels.h"
+#include "reader.h"
+#include "stats.h"
 
 #ifndef MAXLENGTH
 #define MAXLENGTH 50000
 #endif
 
+#define CACHE_TOOL "linelengths 2" /* change when the counts change */
+
 static int classify = 0;
 static int verbose = 0;
 static int statistics = 0;
 static int error_count = 0;
-static unsigned char buffer[BUFFER_SIZE];
+static int read_flags = READER_GUNZIP;
 static size_t linelengths[MAXLENGTH];
 #ifdef __unix__
 static char *progname;
@@ -32,7 +31,8 @@ static const char *const progname = "linelengths";
 
 static void usage(void)
 {
-    fprintf(stderr, "usage: %s [-c] [-s] [-v] [file]...\n", progname);
+    fprintf(stderr, "usage: %s [-c] [-D] [-s] [-v] [-Z] [--cache[=list|compact|purge]]\n"
+                    "       [--cpu=level] [--stats[=json]] [file]...\n", progname);
 }
 
 /* static void arg_err(char c)
@@ -133,50 +133,21 @@ static void classify_file(const char *fname, size_t n)
     }
 }
 
-static void process_lines(const char *fname, size_t n)
+static void end_line(size_t length, size_t *maxLength, int *tooLong)
 {
-    size_t i;
-    size_t length = 0;
-    size_t maxLength = 0;
-    int tooLong = 0;
-    for (i = 0; i < MAXLENGTH; ++i) {
-        linelengths[i] = 0;
+    if (length >= MAXLENGTH) {
+        length = MAXLENGTH-1;
+        ++*tooLong;
     }
-    for (i = 0; i < n; ++i) {
-        unsigned char ch = buffer[i];
-
-        /* Ignore '\r' before '\n' */
-        if (ch == '\r' && i+1 < n && buffer[i+1] == '\n') {
-            continue;
-        }
-
-        if (ch == '\n') {
-            if (length >= MAXLENGTH) {
-                length = MAXLENGTH-1;
-                ++tooLong;
-            }
-            if (length > maxLength) {
-                maxLength = length;
-            }
-            ++linelengths[length];
-            length = 0;
-        } else {
-            ++length;
-        }
+    if (length > *maxLength) {
+        *maxLength = length;
     }
+    ++linelengths[length];
+}
 
-    /* Process remaining bytes if file does not end with \n */
-    if (length > 0) {
-        if (length >= MAXLENGTH) {
-            length = MAXLENGTH-1;
-            ++tooLong;
-        }
-        if (length > maxLength) {
-            maxLength = length;
-        }
-        ++linelengths[length];
-        length = 0;
-    }
+static void report(const char *fname, size_t n, size_t maxLength, int tooLong)
+{
+    size_t i;
 
     if (classify) {
         classify_file(fname, maxLength);
@@ -195,36 +166,161 @@ static void process_lines(const char *fname, size_t n)
     }
 }
 
-static void do_handle(FILE *file, const char *fname)
+/* Counts the lines into linelengths. Returns -1 on a read error. */
+static int count_lines(struct reader *r, size_t *bytes, size_t *maxLengthp, int *tooLongp)
 {
-    size_t bytes_read = fread(buffer, 1, BUFFER_SIZE, file);
-    if (ferror(file)) {
-        fprintf(stderr, "%s: read error (%s)\n", progname, strerror(errno));
-        ++error_count;
-    } else if (feof(file)) {
-        /* Process bytes_read bytes stored in the buffer */
-        process_lines(fname, bytes_read);
-    } else {
-        fprintf(stderr, "%s: could not read until end of file.\n", progname);
+    const unsigned char *block;
+    size_t bytes_read, n = 0;
+    size_t i;
+    size_t length = 0;
+    size_t maxLength = 0;
+    int tooLong = 0;
+    int pendingCR = 0;      /* '\r' at the end of the previous block */
+    for (i = 0; i < MAXLENGTH; ++i) {
+        linelengths[i] = 0;
+    }
+    while ((bytes_read = reader_next(r, &block)) > 0) {
+        const unsigned char *p = block, *q, *end = block + bytes_read;
+        n += bytes_read;
+        while (p < end) {
+            /* Ignore '\r' before '\n' */
+            if (pendingCR) {
+                pendingCR = 0;
+                if (*p != '\n')
+                    ++length;
+            }
+            q = kernels.find_eol(p, end);
+            length += q - p;
+            if (q == end)
+                break;
+            if (*q == '\r') {
+                pendingCR = 1;
+            } else {
+                end_line(length, &maxLength, &tooLong);
+                length = 0;
+            }
+            p = q + 1;
+        }
+    }
+    if (r->error) {
         ++error_count;
+        return -1;
+    }
+    if (pendingCR)
+        ++length;
+
+    /* Process remaining bytes if file does not end with \n */
+    if (length > 0) {
+        end_line(length, &maxLength, &tooLong);
+        length = 0;
+    }
+    *bytes = n;
+    *maxLengthp = maxLength;
+    *tooLongp = tooLong;
+    return 0;
+}
+
+static void process_lines(struct reader *r, const char *fname)
+{
+    size_t n, maxLength;
+    int tooLong;
+
+    if (count_lines(r, &n, &maxLength, &tooLong) == 0)
+        report(fname, n, maxLength, tooLong);
+}
+
+/* The lengths in a gzip file differ when it is decompressed. */
+static const char *cache_options(void)
+{
+    return (read_flags & READER_GUNZIP) && reader_gunzip ? "z" : "";
+}
+
+/* In the cache the counts are kept as bytes, too long lines, maximal
+   length and the pairs of length and count of the lengths found. */
+static void cache_lines(const char *fname, const struct stat *st,
+                        size_t n, size_t maxLength, int tooLong)
+{
+    unsigned long long *data;
+    size_t i, k = 3;
+
+    if ((data = malloc((3 + 2 * (maxLength + 1)) * sizeof(*data))) == NULL)
+        return;
+    data[0] = n;
+    data[1] = tooLong;
+    data[2] = maxLength;
+    for (i = 0; i <= maxLength; ++i) {
+        if (linelengths[i] > 0) {
+            data[k++] = i;
+            data[k++] = linelengths[i];
+        }
+    }
+    cache_put(fname, st, CACHE_TOOL, cache_options(), data, k * sizeof(*data));
+    free(data);
+}
+
+/* The counts of an unchanged file from the cache, without reading it. */
+static int do_cached(const char *fname, const struct stat *st)
+{
+    unsigned long long *data;
+    size_t size, i, k;
+
+    if ((data = cache_get(st, CACHE_TOOL, cache_options(), &size)) == NULL)
+        return 0;
+    k = size / sizeof(*data);
+    if (size % sizeof(*data) != 0 || k < 3 || k % 2 == 0 || data[2] >= MAXLENGTH) {
+        free(data);
+        return 0;
+    }
+    for (i = 0; i < MAXLENGTH; ++i) {
+        linelengths[i] = 0;
+    }
+    for (i = 3; i < k; i += 2) {
+        if (data[i] > data[2]) {
+            free(data);
+            return 0;
+        }
+        linelengths[data[i]] = data[i + 1];
+    }
+    if (verbose && !classify) {
+        printf("\nFile %s:\n\n", fname);
     }
+    report(fname, data[0], data[2], (int) data[1]);
+    free(data);
+    return 1;
 }
 
 static void do_file(const char *fname)
 {
-    FILE *file;
+    struct reader r;
+    struct stat st;
+    size_t n, maxLength;
+    int tooLong;
+    int cacheable = cache_enabled && stat(fname, &st) == 0 && S_ISREG(st.st_mode);
 
-    if ((file = fopen(fname, "rb")) == 0) {
-        fprintf(stderr, "%s: can't open %s (%s)\n",
-                progname, fname, strerror(errno));
+    if (cacheable && do_cached(fname, &st))
+        return;
+    if (reader_open(&r, fname, read_flags) != 0) {
         ++error_count;
         return;
     }
     if (verbose && !classify) {
         printf("\nFile %s:\n\n", fname);
     }
-    do_handle(file, fname);
-    fclose(file);
+    if (count_lines(&r, &n, &maxLength, &tooLong) == 0) {
+        report(fname, n, maxLength, tooLong);
+        if (cacheable)
+            cache_lines(fname, &st, n, maxLength, tooLong);
+    }
+    reader_close(&r);
+}
+
+static void do_stdin(void)
+{
+    struct reader r;
+
+    reader_stdin(&r, read_flags);
+    process_lines(&r, 0);
+    reader_close(&r);
 }
 
 int main(int argc, char *argv[])
@@ -237,14 +333,19 @@ int main(int argc, char *argv[])
     if (ptmp = strrchr(progname, '/'))
         progname = ptmp + 1;
 #endif
+    reader_progname = progname;
+    kernels_level();
     for (--argc, ++argv;  argc > 0;  --argc, ++argv) {
         if (**argv == '-' && do_opts) {
+            if (stats_option(*argv, progname) || kernels_option(*argv, progname)
+                || cache_option(*argv, progname))
+                continue;
             if (argv[0][1] == 0) {
                 if (files_done && !classify)
                     puts("");
                 if (verbose)
                     puts("\nstdin:\n");
-                do_handle(stdin, 0);
+                do_stdin();
                 ++files_done;
                 continue;
             }
@@ -253,6 +354,9 @@ int main(int argc, char *argv[])
                     case 'c':
                         classify = 1;
                         break;
+                    case 'D':
+                        read_flags |= READER_DIRECT;
+                        break;
                     case 'h':
                     case '?':
                         usage();
@@ -263,6 +367,9 @@ int main(int argc, char *argv[])
                     case 'v':
                         ++verbose;
                         break;
+                    case 'Z':
+                        read_flags &= ~READER_GUNZIP;
+                        break;
                     case '-':
                         do_opts = 0;
                         break;
@@ -282,6 +389,6 @@ int main(int argc, char *argv[])
         /* nextarg: ; */
     }
     if (!files_done)
-        do_handle(stdin, 0);
+        do_stdin();
     return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
 }
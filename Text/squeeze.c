@@ -0,0 +1,192 @@
+/* File: squeeze.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Streaming replacement of squeeze.pl and expand.pl, which read every
+ * file as a whole and substituted globally:
+ *
+ *   squeeze    s/\n\n\n/\n\n/g         a run of n newlines keeps n - n/3
+ *   expandnl   s/\n([^\n])/\n\n$1/g    a run followed by a byte gets one more
+ *
+ * Called under another name than expandnl, or without -x, the program
+ * squeezes. Both substitutions only depend on the length of each newline
+ * run and on whether it ends the file, so the input is read in blocks of
+ * fixed size and only the length of the current run is carried from one
+ * block to the next. Text between the runs is found with memchr() and
+ * copied in large writes. Every file is processed on its own like the
+ * Perl scripts did. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 1048576
+#endif
+
+static int expand = 0;
+static int error_count = 0;
+static char in[BLOCK_SIZE];
+static char out[BLOCK_SIZE];
+static char newlines[4096];
+static size_t out_used = 0;
+#ifdef __unix__
+static char *progname;
+#else
+static const char *const progname = "squeeze";
+#endif
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: %s [-x] [file]...\n", progname);
+    fprintf(stderr, "  -x   expand: double the newline before every line (expand.pl)\n");
+}
+
+static void write_all(const char *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t written = write(STDOUT_FILENO, p, n);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "%s: write error (%s)\n", progname, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        p += written;
+        n -= written;
+    }
+}
+
+static void flush_output(void)
+{
+    write_all(out, out_used);
+    out_used = 0;
+}
+
+static void put(const char *p, size_t n)
+{
+    if (out_used + n > sizeof(out)) {
+        flush_output();
+        if (n >= sizeof(out)) {
+            write_all(p, n);
+            return;
+        }
+    }
+    memcpy(out + out_used, p, n);
+    out_used += n;
+}
+
+/* Emits the replacement of a run of n newlines, followed tells whether
+ * another byte comes after it in the file. */
+static void put_run(size_t n, int followed)
+{
+    if (expand)
+        n += followed;
+    else
+        n -= n / 3;
+    while (n > 0) {
+        size_t k = n < sizeof(newlines) ? n : sizeof(newlines);
+        put(newlines, k);
+        n -= k;
+    }
+}
+
+static void do_handle(int fd, const char *fname)
+{
+    size_t run = 0;
+    ssize_t n;
+
+    while ((n = read(fd, in, sizeof(in))) != 0) {
+        const char *p = in, *end;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "%s: error reading %s (%s)\n", progname, fname, strerror(errno));
+            ++error_count;
+            break;
+        }
+        for (end = in + n; p < end; ) {
+            const char *nl = memchr(p, '\n', end - p);
+            if (nl != p) {
+                if (run > 0) {
+                    put_run(run, 1);
+                    run = 0;
+                }
+                if (nl == NULL) {
+                    put(p, end - p);
+                    break;
+                }
+                put(p, nl - p);
+            }
+            for (p = nl; p < end && *p == '\n'; ++p)
+                ++run;
+        }
+    }
+    put_run(run, 0);
+}
+
+static void do_file(const char *fname)
+{
+    int fd;
+
+    if (strcmp(fname, "-") == 0) {
+        do_handle(STDIN_FILENO, "stdin");
+        return;
+    }
+    if ((fd = open(fname, O_RDONLY)) < 0) {
+        fprintf(stderr, "%s: can't open %s (%s)\n", progname, fname, strerror(errno));
+        ++error_count;
+        return;
+    }
+    do_handle(fd, fname);
+    close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef __unix__
+    char *ptmp;
+    progname = argv[0];
+    if ((ptmp = strrchr(progname, '/')))
+        progname = ptmp + 1;
+#endif
+    expand = strcmp(progname, "expandnl") == 0;
+
+    for (--argc, ++argv; argc > 0 && **argv == '-' && argv[0][1]; --argc, ++argv) {
+        if (strcmp(*argv, "--") == 0) {
+            --argc;
+            ++argv;
+            break;
+        }
+        while (*++*argv) {
+            switch (**argv) {
+                case 'h':
+                case '?':
+                    usage();
+                    return EXIT_SUCCESS;
+                case 'x':
+                    expand = 1;
+                    break;
+                default:
+                    fprintf(stderr, "%s: unknown command line flag '%c'.\n",
+                            progname, **argv);
+                    usage();
+                    return EXIT_FAILURE;
+            }
+        }
+    }
+
+    memset(newlines, '\n', sizeof(newlines));
+    if (argc == 0)
+        do_handle(STDIN_FILENO, "stdin");
+    for (; argc > 0; --argc, ++argv)
+        do_file(*argv);
+    flush_output();
+
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
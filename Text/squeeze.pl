@@ -1,7 +0,0 @@
-#!/usr/bin/perl -w
-
-$/ = undef;
-while (<>) {
-    s/\n\n\n/\n\n/g;
-    print;
-}
@@ -0,0 +1,664 @@
+/* File: textprof.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Profile of a text file in a single pass: the byte classes of charstat,
+ * the line lengths and the classification of linelengths -s and -c, with
+ * -w the number and lengths of the words and with -u the UTF-8 characters
+ * and errors. Instead of reading the input three times the work is done
+ * on chunks of a block which still are in the cache, and the reader asks
+ * the kernel for the next block while the current one is profiled.
+ *
+ * Words are separated by white space: blank, tab, newline, carriage
+ * return, vertical tab and form feed. An invalid UTF-8 byte is one which
+ * does not continue a valid sequence, overlong forms, surrogates and code
+ * points above U+10FFFF included. */
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+#include "reader.h"
+#include "stats.h"
+
+#ifndef PORTABLE
+#define GERMAN_UMLAUTS
+#endif
+
+#ifndef MAXLENGTH
+#define MAXLENGTH 50000
+#endif
+
+#ifndef CHUNK
+#define CHUNK 65536             /* part of a block run through all counters */
+#endif
+
+struct profile {
+    unsigned long bytes[UCHAR_MAX+1];
+    size_t lines[MAXLENGTH];
+    uint64_t total;
+    /* lines */
+    size_t length, maxLength;
+    int tooLong;
+    int pendingCR;
+    /* words */
+    size_t wordLength;
+    uint64_t words, wordBytes;
+    size_t longestWord;
+    /* UTF-8 */
+    int need;                   /* continuation bytes still to come */
+    int size;                   /* of the current sequence */
+    unsigned char lo, hi;       /* range of the next continuation byte */
+    uint64_t chars[5];          /* by the length of the sequence */
+    uint64_t invalid;
+    uint64_t firstInvalid;
+    int bom;
+};
+
+/* Byte classes as reported by charstat. */
+struct classes {
+    unsigned long alpha, lowercase, uppercase, digit;
+    unsigned long nl, cr, blank, space, tab;
+    unsigned long germanUmlauts, otherPrintable, other;
+};
+
+static int classify = 0;
+static int json = 0;
+static int histogram = 0;
+static int utf8 = 0;
+static int verbose = 0;
+static int words = 0;
+static int error_count = 0;
+static int read_flags = READER_GUNZIP;
+static int files_done = 0;
+static struct profile prof;
+static unsigned char whiteSpace[UCHAR_MAX+1];
+const static char otherPrintableChars[] = "!\"#$%&?()*+,-./:;<=>@[\\]`^_'{|}~";
+#ifdef __unix__
+static char *progname;
+#else
+static const char *const progname = "textprof";
+#endif
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: %s [-c] [-D] [-j] [-l] [-u] [-v] [-w] [-Z] [--cpu=level] [--stats[=json]]\n"
+                    "       [file]...\n", progname);
+    fprintf(stderr, "  -c   only the classification of the line lengths\n"
+                    "  -D   read with direct I/O, bypassing the page cache\n"
+                    "  -j   write the profile as a JSON object per file\n"
+                    "  -l   list the number of lines of every length\n"
+                    "  -u   UTF-8 statistics\n"
+                    "  -v   verbose, list the count of every byte\n"
+                    "  -w   word statistics\n"
+                    "  -Z   profile gzip files as they are, without decompressing them\n");
+}
+
+static void reset_profile(void)
+{
+    memset(&prof, 0, sizeof(prof));
+}
+
+/* The line lengths, like linelengths: a '\r' before '\n' is ignored. */
+static void end_line(size_t length)
+{
+    if (length >= MAXLENGTH) {
+        length = MAXLENGTH-1;
+        ++prof.tooLong;
+    }
+    if (length > prof.maxLength) {
+        prof.maxLength = length;
+    }
+    ++prof.lines[length];
+}
+
+static void count_lines(const unsigned char *p, const unsigned char *end)
+{
+    const unsigned char *q;
+
+    while (p < end) {
+        if (prof.pendingCR) {
+            prof.pendingCR = 0;
+            if (*p != '\n')
+                ++prof.length;
+        }
+        q = kernels.find_eol(p, end);
+        prof.length += q - p;
+        if (q == end)
+            break;
+        if (*q == '\r') {
+            prof.pendingCR = 1;
+        } else {
+            end_line(prof.length);
+            prof.length = 0;
+        }
+        p = q + 1;
+    }
+}
+
+/* Without branches on the bytes, as words are short: the length of the
+   current word is cleared by the mask of white space. The bytes of the
+   words are known from the histogram at the end. */
+static void count_words(const unsigned char *p, const unsigned char *end)
+{
+    size_t wordLength = prof.wordLength, longest = prof.longestWord;
+    uint64_t words = prof.words;
+    size_t inWord = wordLength > 0;
+
+    for (; p < end; ++p) {
+        size_t white = whiteSpace[*p];
+        words += inWord & white;
+        wordLength = (wordLength + 1) & (white - 1);
+        longest = wordLength > longest ? wordLength : longest;
+        inWord = white ^ 1;
+    }
+    prof.wordLength = wordLength;
+    prof.longestWord = longest;
+    prof.words = words;
+}
+
+static void utf8_error(uint64_t pos)
+{
+    if (prof.invalid++ == 0)
+        prof.firstInvalid = pos;
+}
+
+/* Validates the sequences, the state is kept across chunks. pos is the
+ * offset of p in the input. */
+static void count_utf8(const unsigned char *p, const unsigned char *end, uint64_t pos)
+{
+    const unsigned char *start = p;
+    int c;
+
+    while (p < end) {
+        if (prof.need == 0) {
+            /* runs of ASCII, eight bytes at a time */
+            while (end - p >= 8) {
+                uint64_t v;
+                memcpy(&v, p, 8);
+                if (v & 0x8080808080808080ULL)
+                    break;
+                prof.chars[1] += 8;
+                p += 8;
+            }
+            if (p == end)
+                break;
+            c = *p++;
+            if (c < 0x80) {
+                ++prof.chars[1];
+                continue;
+            }
+            prof.lo = 0x80;
+            prof.hi = 0xbf;
+            if (c >= 0xc2 && c <= 0xdf) {
+                prof.size = 2;
+            } else if (c >= 0xe0 && c <= 0xef) {
+                prof.size = 3;
+                if (c == 0xe0)
+                    prof.lo = 0xa0;     /* overlong */
+                else if (c == 0xed)
+                    prof.hi = 0x9f;     /* surrogates */
+            } else if (c >= 0xf0 && c <= 0xf4) {
+                prof.size = 4;
+                if (c == 0xf0)
+                    prof.lo = 0x90;
+                else if (c == 0xf4)
+                    prof.hi = 0x8f;     /* above U+10FFFF */
+            } else {
+                utf8_error(pos + (p - start) - 1);
+                continue;
+            }
+            prof.need = prof.size - 1;
+        } else {
+            c = *p;
+            if (c < prof.lo || c > prof.hi) {
+                /* the sequence breaks off before this byte, which is
+                   looked at again as the start of a new one */
+                utf8_error(pos + (p - start) - (prof.size - prof.need));
+                prof.need = 0;
+                continue;
+            }
+            ++p;
+            prof.lo = 0x80;
+            prof.hi = 0xbf;
+            if (--prof.need == 0)
+                ++prof.chars[prof.size];
+        }
+    }
+}
+
+static void profile_chunk(const unsigned char *p, size_t n)
+{
+    kernels.histogram(p, n, prof.bytes);
+    count_lines(p, p + n);
+    if (words)
+        count_words(p, p + n);
+    if (utf8) {
+        if (prof.total == 0 && n >= 3 && memcmp(p, "\xef\xbb\xbf", 3) == 0)
+            prof.bom = 1;
+        count_utf8(p, p + n, prof.total);
+    }
+    prof.total += n;
+}
+
+static void finish_profile(void)
+{
+    int i;
+
+    if (prof.pendingCR)
+        ++prof.length;
+    if (prof.length > 0) {
+        end_line(prof.length);
+        prof.length = 0;
+    }
+    if (prof.wordLength > 0)
+        ++prof.words;
+    prof.wordBytes = prof.total;
+    for (i = 0; i <= UCHAR_MAX; ++i) {
+        if (whiteSpace[i])
+            prof.wordBytes -= prof.bytes[i];
+    }
+    if (prof.need > 0)
+        utf8_error(prof.total - (prof.size - prof.need));
+}
+
+static int isOtherPrintable(int c)
+{
+    return c != 0 && strchr(otherPrintableChars, c) != NULL;
+}
+
+#ifdef GERMAN_UMLAUTS
+static int isGermanUmlaut(int c)
+{
+    return c == 0xc4 || c == 0xd6 || c == 0xdc || c == 0xdf
+                     || c == 0xe4 || c == 0xf6 || c == 0xfc;
+}
+#endif
+
+/* The classes of charstat, otherChar gets the bytes of class Other. */
+static void byte_classes(struct classes *k, int otherChar[])
+{
+    const unsigned long *count = prof.bytes;
+    int i;
+
+    memset(k, 0, sizeof(*k));
+    for (i = 0; i <= UCHAR_MAX; ++i) {
+        otherChar[i] = 0;
+        if (isalpha(i)) {
+            k->alpha += count[i];
+            if (i >= 'a' && i <= 'z')
+                k->lowercase += count[i];
+            if (i >= 'A' && i <= 'Z')
+                k->uppercase += count[i];
+        } else if (isdigit(i)) {
+            k->digit += count[i];
+        } else if (i == '\n') {
+            k->nl += count[i];
+        } else if (i == '\r') {
+            k->cr += count[i];
+        } else if (isblank(i)) {
+            k->blank += count[i];
+            if (i == ' ') {
+                k->space += count[i];
+            } else if (i == '\t') {
+                k->tab += count[i];
+            }
+#ifdef GERMAN_UMLAUTS
+        } else if (isGermanUmlaut(i)) {
+            k->germanUmlauts += count[i];
+#endif
+        } else if (isOtherPrintable(i)) {
+            k->otherPrintable += count[i];
+        } else {
+            k->other += count[i];
+            otherChar[i] = count[i] > 0;
+        }
+    }
+}
+
+/* The classification of linelengths -c. */
+static const char *line_class(size_t count[3])
+{
+    const size_t lineThreshold1 = 60;
+    const size_t lineThreshold2 = 90;
+    size_t i;
+
+    count[0] = count[1] = count[2] = 0;
+    for (i = 0; i <= prof.maxLength; ++i) {
+        count[i < lineThreshold1 ? 0 : i < lineThreshold2 ? 1 : 2] += prof.lines[i];
+    }
+    if (count[1] == 0 && count[2] == 0) {
+        return count[0] > 0 ? "Only short lines" : "Empty";
+    } else if (count[2] == 0) {
+        return "Normal length lines";
+    } else if (count[2] >= 10 && count[2] >= 2 * count[1]) {
+        return "Long lines";
+    } else if (count[2] <=  5 && count[1] >=  50
+            || count[2] <= 10 && count[1] >= 200
+            || count[2] <= 20 && count[1] >= 500) {
+        return "Normal length lines";
+    }
+    return "Undefined";
+}
+
+static void line_sums(size_t *lineCount, unsigned long *sum)
+{
+    size_t i;
+
+    *lineCount = 0;
+    *sum = 0;
+    for (i = 0; i <= prof.maxLength; ++i) {
+        *lineCount += prof.lines[i];
+        *sum += i * prof.lines[i];
+    }
+}
+
+static uint64_t utf8_chars(void)
+{
+    return prof.chars[1] + prof.chars[2] + prof.chars[3] + prof.chars[4];
+}
+
+static void print_text(const char *fname)
+{
+    struct classes k;
+    int otherChar[UCHAR_MAX+1];
+    size_t count[3], lineCount, i;
+    unsigned long sum;
+    const char *classification = line_class(count);
+
+    if (classify) {
+        printf("%s -> %s\n", fname == 0 ? "<stdin>" : fname, classification);
+        if (verbose)
+            printf("    classification counts: %lu %lu %lu\n", count[0], count[1], count[2]);
+        return;
+    }
+
+    byte_classes(&k, otherChar);
+    if (verbose && prof.total > 0) {
+        for (i = 0; i <= UCHAR_MAX; ++i) {
+            if (prof.bytes[i] > 0) {
+                printf(" %3lu %8lu\n", i, prof.bytes[i]);
+            }
+        }
+        puts("");
+    }
+    printf("Alphabetic      %9lu\n", k.alpha);
+    printf("    Lowercase   %9lu\n", k.lowercase);
+    printf("    Uppercase   %9lu\n", k.uppercase);
+    printf("Digit           %9lu\n", k.digit);
+    printf("New Line        %9lu\n", k.nl);
+    printf("Carriage Return %9lu\n", k.cr);
+    printf("Blank           %9lu\n", k.blank);
+    printf("    Space       %9lu\n", k.space);
+    printf("    Tab         %9lu\n", k.tab);
+#ifdef GERMAN_UMLAUTS
+    if (k.germanUmlauts > 0) {
+        printf("German Unlauts  %9lu\n", k.germanUmlauts);
+    }
+#endif
+    printf("Other Printable %9lu\n", k.otherPrintable);
+    printf("Other           %9lu\n", k.other);
+    printf("TOTAL           %9lu\n", (unsigned long) prof.total);
+    for (i = 0; i <= UCHAR_MAX && !otherChar[i]; ++i)
+        ;
+    if (i <= UCHAR_MAX) {
+        puts("");
+        printf("Other Characters are: ");
+        for (i = 0; i <= UCHAR_MAX; ++i) {
+            if (otherChar[i])
+                printf(isprint(i) ? " '%c'" : " %2x", (int) i);
+        }
+        puts("");
+    }
+
+    if (histogram) {
+        puts("");
+        for (i = 0; i <= prof.maxLength; ++i) {
+            if (prof.lines[i] > 0) {
+                printf("%lu  %lu\n", i, prof.lines[i]);
+            }
+        }
+    }
+    if (prof.tooLong) {
+        printf("\nToo long lines detected: %d\n", prof.tooLong);
+    }
+    line_sums(&lineCount, &sum);
+    printf("\nNumber of lines:  %10lu\n", lineCount);
+    printf("Sum of line bytes:%10lu\n", sum);
+    if (lineCount > 0) {
+        printf("Average line length: %10.2f\n", (double)sum / lineCount);
+    }
+    printf("Longest line:     %10lu\n", prof.maxLength);
+    printf("Classification:   %s\n", classification);
+
+    if (words) {
+        printf("\nWords:            %10lu\n", (unsigned long) prof.words);
+        if (prof.words > 0) {
+            printf("Average word length: %10.2f\n", (double)prof.wordBytes / prof.words);
+        }
+        printf("Longest word:     %10lu\n", prof.longestWord);
+    }
+
+    if (utf8) {
+        printf("\nUTF-8 characters: %10lu\n", (unsigned long) utf8_chars());
+        for (i = 1; i <= 4; ++i)
+            printf("    %lu byte%s     %10lu\n", i, i > 1 ? "s" : " ", (unsigned long) prof.chars[i]);
+        printf("Invalid bytes:    %10lu\n", (unsigned long) prof.invalid);
+        if (prof.invalid > 0)
+            printf("    the first at  %10lu\n", (unsigned long) prof.firstInvalid);
+        printf("Byte order mark:  %10s\n", prof.bom ? "yes" : "no");
+    }
+}
+
+static void print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s; ++s) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+    putchar('"');
+}
+
+/* One object on a single line. */
+static void print_json(const char *fname)
+{
+    struct classes k;
+    int otherChar[UCHAR_MAX+1];
+    size_t count[3], lineCount, i;
+    unsigned long sum;
+    const char *classification = line_class(count);
+    const char *sep = "";
+
+    byte_classes(&k, otherChar);
+    line_sums(&lineCount, &sum);
+    printf("{\"file\":");
+    if (fname)
+        print_json_string(fname);
+    else
+        printf("null");
+    printf(",\"bytes\":%lu", (unsigned long) prof.total);
+    printf(",\"classes\":{\"alphabetic\":%lu,\"lowercase\":%lu,\"uppercase\":%lu,"
+           "\"digit\":%lu,\"newline\":%lu,\"carriage_return\":%lu,\"blank\":%lu,"
+           "\"space\":%lu,\"tab\":%lu,\"german_umlauts\":%lu,"
+           "\"other_printable\":%lu,\"other\":%lu}",
+           k.alpha, k.lowercase, k.uppercase, k.digit, k.nl, k.cr, k.blank,
+           k.space, k.tab, k.germanUmlauts, k.otherPrintable, k.other);
+    if (verbose) {
+        printf(",\"byte_counts\":{");
+        for (i = 0; i <= UCHAR_MAX; ++i) {
+            if (prof.bytes[i] > 0) {
+                printf("%s\"%lu\":%lu", sep, i, prof.bytes[i]);
+                sep = ",";
+            }
+        }
+        printf("}");
+    }
+    printf(",\"lines\":{\"count\":%lu,\"sum\":%lu,\"average\":%.2f,\"longest\":%lu,"
+           "\"too_long\":%d,\"classification\":\"%s\",\"class_counts\":[%lu,%lu,%lu]",
+           lineCount, sum, lineCount > 0 ? (double)sum / lineCount : 0.0,
+           prof.maxLength, prof.tooLong, classification, count[0], count[1], count[2]);
+    if (histogram) {
+        printf(",\"lengths\":{");
+        sep = "";
+        for (i = 0; i <= prof.maxLength; ++i) {
+            if (prof.lines[i] > 0) {
+                printf("%s\"%lu\":%lu", sep, i, prof.lines[i]);
+                sep = ",";
+            }
+        }
+        printf("}");
+    }
+    printf("}");
+    if (words) {
+        printf(",\"words\":{\"count\":%lu,\"average\":%.2f,\"longest\":%lu}",
+               (unsigned long) prof.words,
+               prof.words > 0 ? (double)prof.wordBytes / prof.words : 0.0,
+               prof.longestWord);
+    }
+    if (utf8) {
+        printf(",\"utf8\":{\"characters\":%lu,\"by_length\":[%lu,%lu,%lu,%lu],"
+               "\"invalid\":%lu,\"first_invalid\":",
+               (unsigned long) utf8_chars(), (unsigned long) prof.chars[1],
+               (unsigned long) prof.chars[2], (unsigned long) prof.chars[3],
+               (unsigned long) prof.chars[4], (unsigned long) prof.invalid);
+        if (prof.invalid > 0)
+            printf("%lu", (unsigned long) prof.firstInvalid);
+        else
+            printf("null");
+        printf(",\"bom\":%s}", prof.bom ? "true" : "false");
+    }
+    printf("}\n");
+}
+
+static void do_handle(struct reader *r, const char *fname)
+{
+    const unsigned char *block;
+    size_t bytes_read, i, n;
+
+    reset_profile();
+    while ((bytes_read = reader_next(r, &block)) > 0) {
+        for (i = 0; i < bytes_read; i += n) {
+            n = bytes_read - i < CHUNK ? bytes_read - i : CHUNK;
+            profile_chunk(block + i, n);
+        }
+    }
+    if (r->error) {
+        ++error_count;
+        return;
+    }
+    finish_profile();
+    if (json) {
+        print_json(fname);
+    } else {
+        if (files_done && !classify)
+            puts("");
+        if (fname && !classify)
+            printf("File %s:\n\n", fname);
+        print_text(fname);
+    }
+    ++files_done;
+}
+
+static void do_file(const char *fname)
+{
+    struct reader r;
+
+    if (reader_open(&r, fname, read_flags) != 0) {
+        ++error_count;
+        return;
+    }
+    do_handle(&r, fname);
+    reader_close(&r);
+}
+
+static void do_stdin(void)
+{
+    struct reader r;
+
+    reader_stdin(&r, read_flags);
+    do_handle(&r, 0);
+    reader_close(&r);
+}
+
+int main(int argc, char *argv[])
+{
+    int do_opts = 1;
+    int inputs = 0;
+#ifdef __unix__
+    char *ptmp;
+    progname = argv[0];
+    if (ptmp = strrchr(progname, '/'))
+        progname = ptmp + 1;
+#endif
+    reader_progname = progname;
+    kernels_level();
+    whiteSpace[' '] = whiteSpace['\t'] = whiteSpace['\n'] = 1;
+    whiteSpace['\v'] = whiteSpace['\f'] = whiteSpace['\r'] = 1;
+    for (--argc, ++argv;  argc > 0;  --argc, ++argv) {
+        if (**argv == '-' && do_opts) {
+            if (stats_option(*argv, progname) || kernels_option(*argv, progname))
+                continue;
+            if (argv[0][1] == 0) {
+                do_stdin();
+                ++inputs;
+                continue;
+            }
+            while (*++*argv) {
+                switch (**argv) {
+                    case 'c':
+                        classify = 1;
+                        break;
+                    case 'D':
+                        read_flags |= READER_DIRECT;
+                        break;
+                    case 'h':
+                    case '?':
+                        usage();
+                        return EXIT_SUCCESS;
+                    case 'j':
+                        json = 1;
+                        break;
+                    case 'l':
+                        histogram = 1;
+                        break;
+                    case 'u':
+                        utf8 = 1;
+                        break;
+                    case 'v':
+                        ++verbose;
+                        break;
+                    case 'w':
+                        words = 1;
+                        break;
+                    case 'Z':
+                        read_flags &= ~READER_GUNZIP;
+                        break;
+                    case '-':
+                        do_opts = 0;
+                        break;
+                    default:
+                        fprintf(stderr, "%s: unknown command line flag '%c'.\n",
+                                progname, **argv);
+                        usage();
+                        return EXIT_FAILURE;
+                }
+            }
+        } else {
+            do_file(*argv);
+            ++inputs;
+        }
+    }
+    if (!inputs)
+        do_stdin();
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,1077 @@
+/* File: wordcount.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Counts the words of UTF-8 texts, replaces wordcount.pl with the same
+ * normalization and output. Words are lowercased (A-Z and the German
+ * umlauts), quotes and dashes at their ends are removed, and the first
+ * hyphenation in a paragraph is joined. Words found in the dictionaries
+ * of option -d (German), -e (English) or in the files given with
+ * -w file:file... are not counted. Output is sorted by the words, with
+ * option -n by frequency.
+ *
+ * The input is cut into blocks at paragraph ends, which are counted by
+ * several threads (-j) into their own hash tables, merged at the end.
+ *
+ * The normalized ignore words are kept in an index file below
+ * $XDG_CACHE_HOME/wordcount (or ~/.cache/wordcount), one per list of
+ * dictionaries. It holds the hash table itself, so it is only mapped
+ * and used as it is. The index records size, inode and modification
+ * time of every dictionary and is rebuilt when one of them has changed;
+ * option -c rebuilds it unconditionally and exits. */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 4194304
+#endif
+
+#define DICT_PATH   "/usr/share/dict/"
+#define SPLITCHAR   ':'
+#define ARENA_CHUNK 1048576
+#define TABLE_SIZE  4096        /* initial size, a power of two */
+
+#define INDEX_MAGIC   "WCIGNOR\n"
+#define INDEX_VERSION 1
+
+static const char *const english_dicts[] = { "american-english", "british-english", 0 };
+static const char *const german_dicts[] = { "ogerman", "ngerman", 0 };
+
+/* Character classes of the tokenizer. */
+enum { WORD, SPACE, PUNCT };
+
+struct arena {
+    char *chunk;
+    size_t used, size;
+};
+
+struct word {
+    const char *key;
+    size_t length;
+    uint64_t hash;
+    long count;
+};
+
+/* Open addressing table of words, the keys are kept in the arena. */
+struct table {
+    struct word *slot;
+    size_t size, used;
+    struct arena arena;
+};
+
+/* A dictionary of the ignore list and its identity when it was read. */
+struct source {
+    char *name;
+    const char *mode;           /* verbose heading before the first file */
+    struct stat st;
+    int found;
+};
+
+/* The index file: the header, the source records, the slots of an open
+ * addressing table like struct table, and the pool of the words. The
+ * header checksum covers the header and the source records. */
+struct index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t sources;
+    uint64_t sources_size;      /* bytes, a multiple of 8 */
+    uint64_t slots;             /* a power of two */
+    uint64_t words;
+    uint64_t pool_size;
+    uint64_t header_checksum;
+};
+
+/* Followed by the name, padded with zeros to a multiple of 8. */
+struct index_source {
+    uint64_t size;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t name_length;
+    uint32_t reserved;
+};
+
+/* length 0 marks an empty slot. */
+struct index_slot {
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct block {
+    char *data;
+    size_t length;
+    struct block *next;
+};
+
+static int verbose = 0;
+static int compile_only = 0;
+static int by_frequency = 0;
+static int threads = 0;
+static int error_count = 0;
+
+static struct table ignore;
+static struct source *sources = 0;
+static int source_count = 0;
+static const struct index_slot *index_slots = 0;
+static const char *index_pool;
+static uint64_t index_mask;
+static unsigned char ascii_class[128];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
+static struct block *queue_head = 0, *queue_tail = 0;
+static int queued = 0, queue_max = 2, input_done = 0;
+
+#ifdef __unix__
+static char *progname;
+#else
+static const char *const progname = "wordcount";
+#endif
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: %s [-c] [-d] [-e] [-n] [-v] [-w file:...] [-j threads] [file]...\n",
+            progname);
+}
+
+static void arg_err(char c)
+{
+    fprintf(stderr, "%s: option -%c requires an argument.\n", progname, c);
+    usage();
+    exit(EXIT_FAILURE);
+}
+
+static void *xrealloc(void *p, size_t size)
+{
+    if ((p = realloc(p, size)) == NULL && size > 0) {
+        fprintf(stderr, "%s: out of memory\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void init_classes(void)
+{
+    static const char punct[] = ",;:.?!\"()[]{}+*/~=<>$&|_#@%^\\";
+    const char *p;
+    int c;
+
+    for (c = 0; c < 128; ++c)
+        ascii_class[c] = WORD;
+    for (p = " \t\n\v\f\r"; *p; ++p)
+        ascii_class[(unsigned char) *p] = SPACE;
+    for (p = punct; *p; ++p)
+        ascii_class[(unsigned char) *p] = PUNCT;
+}
+
+/* Class of a code point above 127: the whitespace of Perl's \s and the
+ * punctuation which wordcount.pl replaced by spaces. */
+static int unicode_class(uint32_t c)
+{
+    switch (c) {
+      case 0x85: case 0xa0: case 0x1680: case 0x2028: case 0x2029:
+      case 0x202f: case 0x205f: case 0x3000:
+        return SPACE;
+      case 0x2033: case 0x20ac: case 0xa3: case 0x201c: case 0x201d:
+      case 0x201e: case 0x2018: case 0xbb: case 0xab: case 0x201a:
+      case 0x2014: case 0x2026: case 0xb0:
+        return PUNCT;
+    }
+    return c >= 0x2000 && c <= 0x200a ? SPACE : WORD;
+}
+
+/* Decodes the UTF-8 character at s, returns its length. Bytes which don't
+ * start a valid sequence are taken as a character of their own. */
+static int decode(const unsigned char *s, const unsigned char *end, uint32_t *c)
+{
+    int n, i;
+
+    if (s[0] < 0xc2 || s[0] > 0xf4) {
+        *c = 0xfffd;
+        return 1;
+    }
+    n = s[0] < 0xe0 ? 2 : s[0] < 0xf0 ? 3 : 4;
+    if (end - s < n) {
+        *c = 0xfffd;
+        return 1;
+    }
+    *c = s[0] & (0x7f >> n);
+    for (i = 1; i < n; ++i) {
+        if ((s[i] & 0xc0) != 0x80) {
+            *c = 0xfffd;
+            return 1;
+        }
+        *c = *c << 6 | (s[i] & 0x3f);
+    }
+    return n;
+}
+
+static void *arena_alloc(struct arena *a, size_t size)
+{
+    void *p;
+    if (a->used + size > a->size) {
+        a->size = size > ARENA_CHUNK ? size : ARENA_CHUNK;
+        a->chunk = xrealloc(0, a->size);
+        a->used = 0;
+    }
+    p = a->chunk + a->used;
+    a->used += size;
+    return p;
+}
+
+static uint64_t hash_bytes(const char *s, size_t length)
+{
+    uint64_t h = 14695981039346656037ULL;
+    while (length-- > 0) {
+        h ^= (unsigned char) *s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void table_grow(struct table *t)
+{
+    size_t size = t->size ? 2 * t->size : TABLE_SIZE;
+    struct word *slot = xrealloc(0, size * sizeof(*slot));
+    size_t i;
+
+    memset(slot, 0, size * sizeof(*slot));
+    for (i = 0; i < t->size; ++i) {
+        if (t->slot[i].key != NULL) {
+            size_t k = t->slot[i].hash & (size - 1);
+            while (slot[k].key != NULL)
+                k = (k + 1) & (size - 1);
+            slot[k] = t->slot[i];
+        }
+    }
+    free(t->slot);
+    t->slot = slot;
+    t->size = size;
+}
+
+/* Finds the word, adds it with count 0 if add is set. */
+static struct word *lookup(struct table *t, const char *s, size_t length,
+                           uint64_t hash, int add)
+{
+    size_t k;
+    char *key;
+
+    if (t->size == 0) {
+        if (!add)
+            return NULL;
+        table_grow(t);
+    }
+    for (k = hash & (t->size - 1); t->slot[k].key != NULL; k = (k + 1) & (t->size - 1)) {
+        if (t->slot[k].hash == hash && t->slot[k].length == length
+            && memcmp(t->slot[k].key, s, length) == 0)
+            return &t->slot[k];
+    }
+    if (!add)
+        return NULL;
+    if (2 * (t->used + 1) > t->size) {
+        table_grow(t);
+        return lookup(t, s, length, hash, add);
+    }
+    key = arena_alloc(&t->arena, length + 1);
+    memcpy(key, s, length);
+    key[length] = '\0';
+    t->slot[k].key = key;
+    t->slot[k].length = length;
+    t->slot[k].hash = hash;
+    t->slot[k].count = 0;
+    ++t->used;
+    return &t->slot[k];
+}
+
+/* Replaces the sequence from by to in the word, to is not longer. */
+static size_t replace_all(char *w, size_t length, const char *from, const char *to)
+{
+    size_t from_length = strlen(from), to_length = strlen(to), i, n = 0;
+
+    for (i = 0; i < length; ) {
+        if (i + from_length <= length && memcmp(w + i, from, from_length) == 0) {
+            memcpy(w + n, to, to_length);
+            n += to_length;
+            i += from_length;
+        } else {
+            w[n++] = w[i++];
+        }
+    }
+    return n;
+}
+
+static int is_trimmed(const char *w, size_t i, size_t length, int dict)
+{
+    if (w[i] == '\'' || w[i] == '`' || w[i] == '-')
+        return 1;
+    return dict && i + 3 <= length && memcmp(w + i, "\xe2\x80\x99", 3) == 0;
+}
+
+/* Looks the word up in the mapped index, else in the ignore table. */
+static int ignored(const char *w, size_t length, uint64_t hash)
+{
+    uint64_t k;
+
+    if (index_slots == NULL)
+        return ignore.used != 0 && lookup(&ignore, w, length, hash, 0) != NULL;
+    for (k = hash & index_mask; index_slots[k].length != 0; k = (k + 1) & index_mask) {
+        if (index_slots[k].hash == hash && index_slots[k].length == length
+            && memcmp(index_pool + index_slots[k].offset, w, length) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Handles a word as wordcount.pl did after split(). In a dictionary
+ * (dict set) the word is added to the table, else counted if it is not
+ * in the ignore table. */
+static void add_word(struct table *t, char *w, size_t length, int dict)
+{
+    size_t i, start = 0;
+    uint64_t hash;
+
+    /* sequences of characters which Perl saw decoded byte by byte */
+    if (memchr(w, 0xc2, length) != NULL) {
+        length = replace_all(w, length, "\xc3\x83\xc2\x84", "\xc3\x83\xc2\xa4");
+        length = replace_all(w, length, "\xc3\x83\xc2\x96", "\xc3\x83\xc2\xb6");
+        length = replace_all(w, length, "\xc3\x83\xc2\x9c", "\xc3\x83\xc2\xbc");
+        if (!dict)
+            length = replace_all(w, length, "\xc3\xa2\xc2\x80\xc2\x99", "'");
+    }
+
+    /* s/^['`’-]+//; s/['`’-]+$//; */
+    while (start < length && is_trimmed(w, start, length, dict))
+        start += w[start] == '\xe2' ? 3 : 1;
+    while (length > start) {
+        if (w[length-1] == '\'' || w[length-1] == '`' || w[length-1] == '-')
+            --length;
+        else if (dict && length - start >= 3 && memcmp(w + length - 3, "\xe2\x80\x99", 3) == 0)
+            length -= 3;
+        else
+            break;
+    }
+    w += start;
+    length -= start;
+
+    if (!dict) {
+        /* s/^[0-9]+′[0-9]+$//; and the word – alone */
+        const char *prime = memchr(w, '\xe2', length);
+        if (prime && prime > w && prime - w + 3 < (ptrdiff_t) length
+            && memcmp(prime, "\xe2\x80\xb2", 3) == 0) {
+            size_t p = prime - w;
+            for (i = 0; i < length && (i >= p && i < p + 3 || w[i] >= '0' && w[i] <= '9'); ++i)
+                ;
+            if (i == length)
+                return;
+        }
+        if (length == 3 && memcmp(w, "\xe2\x80\x93", 3) == 0)
+            return;
+    }
+
+    /* unless /^[0-9'`’-]*$/ */
+    for (i = 0; i < length; ) {
+        if (w[i] >= '0' && w[i] <= '9' || w[i] == '\'' || w[i] == '`' || w[i] == '-')
+            ++i;
+        else if (length - i >= 3 && memcmp(w + i, "\xe2\x80\x99", 3) == 0)
+            i += 3;
+        else
+            break;
+    }
+    if (i == length)
+        return;
+
+    hash = hash_bytes(w, length);
+    if (dict) {
+        lookup(t, w, length, hash, 1)->count++;
+    } else if (!ignored(w, length, hash)) {
+        lookup(t, w, length, hash, 1)->count++;
+    }
+}
+
+/* Splits text into words, lowercasing it like tr/A-Z/a-z/ and
+ * s/Ä/ä/g etc. Outside of dictionaries ’ and ´ become ' and the
+ * punctuation separates words like whitespace. */
+static void split_words(struct table *t, const unsigned char *s, const unsigned char *end,
+                        int dict)
+{
+    char stack_word[256], *w = stack_word;
+    size_t length = 0, size = sizeof(stack_word);
+
+    while (s < end) {
+        uint32_t c;
+        int n, cls;
+
+        if (*s < 128) {
+            c = *s;
+            n = 1;
+            cls = ascii_class[c];
+        } else {
+            n = decode(s, end, &c);
+            cls = unicode_class(c);
+        }
+        if (dict && cls == PUNCT)
+            cls = WORD;
+        if (cls != WORD) {
+            if (length > 0)
+                add_word(t, w, length, dict);
+            length = 0;
+            s += n;
+            continue;
+        }
+        if (length + 4 > size) {
+            size *= 2;
+            w = w == stack_word ? memcpy(xrealloc(0, size), stack_word, length)
+                                : xrealloc(w, size);
+        }
+        if (c >= 'A' && c <= 'Z') {
+            w[length++] = c + 'a' - 'A';
+        } else if (c == 0xc4 || c == 0xd6 || c == 0xdc) {
+            w[length++] = '\xc3';
+            w[length++] = s[1] + 0x20;
+        } else if (!dict && (c == 0x2019 || c == 0xb4)) {
+            w[length++] = '\'';
+        } else {
+            memcpy(w + length, s, n);
+            length += n;
+        }
+        s += n;
+    }
+    if (length > 0)
+        add_word(t, w, length, dict);
+    if (w != stack_word)
+        free(w);
+}
+
+/* Goes through the paragraphs of a block like Perl's paragraph mode:
+ * newlines before a paragraph are skipped, it ends after two newlines.
+ * A BOM at its start is removed, and outside of dictionaries its first
+ * "-\n" is joined. */
+static void count_block(struct table *t, char *data, size_t length, int dict)
+{
+    char *s = data, *end = data + length;
+
+    while (s < end) {
+        char *para_end, *hyphen;
+        while (s < end && *s == '\n')
+            ++s;
+        if (s == end)
+            break;
+        para_end = memmem(s, end - s, "\n\n", 2);
+        para_end = para_end ? para_end + 2 : end;
+        if (para_end - s >= 3 && memcmp(s, "\xef\xbb\xbf", 3) == 0)
+            s += 3;
+        if (!dict && (hyphen = memmem(s, para_end - s, "-\n", 2)) != NULL) {
+            memmove(s + 2, s, hyphen - s);
+            s += 2;
+        }
+        split_words(t, (unsigned char *) s, (unsigned char *) para_end, dict);
+        s = para_end;
+    }
+}
+
+static void *worker(void *arg)
+{
+    struct table *t = arg;
+
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        struct block *b;
+        while (queue_head == NULL && !input_done)
+            pthread_cond_wait(&not_empty, &lock);
+        if (queue_head == NULL)
+            break;
+        b = queue_head;
+        if ((queue_head = b->next) == NULL)
+            queue_tail = NULL;
+        --queued;
+        pthread_cond_signal(&not_full);
+        pthread_mutex_unlock(&lock);
+        count_block(t, b->data, b->length, 0);
+        free(b->data);
+        free(b);
+        pthread_mutex_lock(&lock);
+    }
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+static void submit(char *data, size_t length)
+{
+    struct block *b = xrealloc(0, sizeof(*b));
+    b->data = data;
+    b->length = length;
+    b->next = NULL;
+    pthread_mutex_lock(&lock);
+    while (queued >= queue_max)
+        pthread_cond_wait(&not_full, &lock);
+    if (queue_tail)
+        queue_tail->next = b;
+    else
+        queue_head = b;
+    queue_tail = b;
+    ++queued;
+    pthread_cond_signal(&not_empty);
+    pthread_mutex_unlock(&lock);
+}
+
+/* Reads a file in blocks, cut after the last paragraph end in each, and
+ * hands them to the threads. A paragraph longer than a block makes the
+ * block grow. */
+static void do_handle(int fd, const char *fname)
+{
+    size_t size = BLOCK_SIZE, used = 0;
+    char *data = xrealloc(0, size);
+    int eof = 0;
+
+    while (!eof) {
+        ssize_t n = read(fd, data + used, size - used);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "%s: error reading %s (%s)\n", progname, fname, strerror(errno));
+            ++error_count;
+            break;
+        }
+        eof = n == 0;
+        used += n;
+        if (used == size || eof) {
+            char *cut = NULL, *p;
+            for (p = data + used - 1; p > data && !eof; --p) {
+                if (p[0] == '\n' && p[-1] == '\n') {
+                    cut = p + 1;
+                    break;
+                }
+            }
+            if (eof) {
+                cut = data + used;
+            } else if (cut == NULL) {
+                size *= 2;
+                data = xrealloc(data, size);
+                continue;
+            }
+            {
+                size_t rest = data + used - cut;
+                char *next = xrealloc(0, BLOCK_SIZE > rest ? BLOCK_SIZE : 2 * rest);
+                memcpy(next, cut, rest);
+                submit(data, cut - data);
+                data = next;
+                size = BLOCK_SIZE > rest ? BLOCK_SIZE : 2 * rest;
+                used = rest;
+            }
+        }
+    }
+    if (used > 0)
+        submit(data, used);
+    else
+        free(data);
+}
+
+static void do_file(const char *fname)
+{
+    int fd;
+
+    if (strcmp(fname, "-") == 0) {
+        do_handle(STDIN_FILENO, "stdin");
+        return;
+    }
+    if ((fd = open(fname, O_RDONLY)) < 0) {
+        fprintf(stderr, "%s: can't open %s (%s)\n", progname, fname, strerror(errno));
+        ++error_count;
+        return;
+    }
+    do_handle(fd, fname);
+    close(fd);
+}
+
+/* Reads a dictionary into the ignore table. wordcount.pl read these in
+ * paragraph mode too, so a BOM is only removed at a paragraph start. */
+static void read_ignorefile(const char *fname)
+{
+    size_t size = BLOCK_SIZE, used = 0;
+    char *data;
+    ssize_t n;
+    int fd;
+
+    if (verbose)
+        fprintf(stderr, "  reading in words from %s\n", fname);
+    if ((fd = open(fname, O_RDONLY)) < 0) {
+        fprintf(stderr, "Can't open file %s: %s\n", fname, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    data = xrealloc(0, size);
+    while ((n = read(fd, data + used, size - used)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "%s: error reading %s (%s)\n", progname, fname, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        used += n;
+        if (used == size)
+            data = xrealloc(data, size *= 2);
+    }
+    close(fd);
+    count_block(&ignore, data, used, 1);
+    free(data);
+}
+
+static void add_source(char *name, const char *mode)
+{
+    struct source *s;
+
+    sources = xrealloc(sources, (source_count + 1) * sizeof(*sources));
+    s = &sources[source_count++];
+    s->name = name;
+    s->mode = mode;
+    /* taken before reading, a later change makes the index stale */
+    s->found = stat(name, &s->st) == 0;
+}
+
+static void add_dicts(const char *const *names, const char *mode)
+{
+    for (; *names; ++names, mode = NULL) {
+        char *fname = xrealloc(0, strlen(DICT_PATH) + strlen(*names) + 1);
+        add_source(strcat(strcpy(fname, DICT_PATH), *names), mode);
+    }
+}
+
+static void add_ignore_list(const char *list, const char *mode)
+{
+    const char *home = getenv("HOME");
+    char *copy = xrealloc(0, strlen(list) + 1), *p, *next;
+
+    for (p = strcpy(copy, list); p; p = next, mode = NULL) {
+        if ((next = strchr(p, SPLITCHAR)) != NULL)
+            *next++ = '\0';
+        if (*p == '\0' && (next == NULL || next[strspn(next, ":")] == '\0'))
+            break;
+        if (p[0] == '~' && home) {
+            char *fname = xrealloc(0, strlen(home) + strlen(p));
+            add_source(strcat(strcpy(fname, home), p + 1), mode);
+        } else {
+            add_source(strcpy(xrealloc(0, strlen(p) + 1), p), mode);
+        }
+    }
+    free(copy);
+}
+
+static void read_sources(void)
+{
+    int i;
+    for (i = 0; i < source_count; ++i) {
+        if (verbose && sources[i].mode)
+            fprintf(stderr, "%s\n", sources[i].mode);
+        read_ignorefile(sources[i].name);
+    }
+}
+
+/* FNV-1a continued from h, 0 starts a new checksum. */
+static uint64_t checksum(uint64_t h, const void *data, size_t n)
+{
+    const unsigned char *p = data;
+    if (h == 0)
+        h = 14695981039346656037ULL;
+    while (n-- > 0)
+        h = (h ^ *p++) * 1099511628211ULL;
+    return h;
+}
+
+static size_t source_record_size(const struct source *s)
+{
+    return sizeof(struct index_source) + (strlen(s->name) + 8) / 8 * 8;
+}
+
+/* The index of a list of dictionaries is named after their names. */
+static char *index_name(void)
+{
+    const char *cache = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+    uint64_t h = 0;
+    char *name;
+    int i;
+
+    for (i = 0; i < source_count; ++i)
+        h = checksum(h, sources[i].name, strlen(sources[i].name) + 1);
+    if (cache != NULL && *cache) {
+        name = xrealloc(0, strlen(cache) + 48);
+        mkdir(strcpy(name, cache), 0700);
+        strcat(name, "/wordcount");
+    } else if (home != NULL && *home) {
+        name = xrealloc(0, strlen(home) + 48);
+        sprintf(name, "%s/.cache", home);
+        mkdir(name, 0700);
+        strcat(name, "/wordcount");
+    } else {
+        return NULL;
+    }
+    mkdir(name, 0700);
+    sprintf(name + strlen(name), "/ignore-%016llx.idx", (unsigned long long) h);
+    return name;
+}
+
+/* The checksum covers header and sources only: every word must lie in
+ * the pool, and an empty slot must end the probes of ignored(). */
+static int slots_valid(const struct index_slot *slot, uint64_t slots, uint64_t pool_size)
+{
+    uint64_t k, empty = 0;
+
+    for (k = 0; k < slots; ++k) {
+        if (slot[k].length == 0)
+            ++empty;
+        else if (slot[k].offset > pool_size || slot[k].length > pool_size - slot[k].offset)
+            return 0;
+    }
+    return empty > 0;
+}
+
+/* Maps the index if it exists and matches the dictionaries. */
+static int load_index(const char *iname)
+{
+    const struct index_header *h;
+    const char *p, *problem = NULL;
+    struct stat ist;
+    void *map;
+    int fd, i;
+
+    if ((fd = open(iname, O_RDONLY)) < 0)
+        return 0;
+    if (fstat(fd, &ist) != 0 || (size_t) ist.st_size < sizeof(*h)) {
+        close(fd);
+        return 0;
+    }
+    if ((map = mmap(0, ist.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    h = map;
+    p = (const char *) (h + 1);
+    if (memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) != 0)
+        problem = "not an index file";
+    else if (h->version != INDEX_VERSION)
+        problem = "wrong version";
+    else if (h->sources_size > (uint64_t) ist.st_size - sizeof(*h)
+             || h->header_checksum != checksum(checksum(0, h, offsetof(struct index_header,
+                                                                     header_checksum)),
+                                               p, h->sources_size))
+        problem = "bad header checksum";
+    else if (h->slots == 0 || (h->slots & (h->slots - 1)) != 0
+             || (uint64_t) ist.st_size != sizeof(*h) + h->sources_size
+                                          + h->slots * sizeof(struct index_slot) + h->pool_size)
+        problem = "truncated";
+    else if (h->sources != (uint32_t) source_count)
+        problem = "stale";
+    for (i = 0; problem == NULL && i < source_count; ++i) {
+        const struct index_source *r = (const struct index_source *) p;
+        const struct stat *st = &sources[i].st;
+        if (!sources[i].found || r->size != (uint64_t) st->st_size
+            || r->ino != (uint64_t) st->st_ino || r->mtime_sec != st->st_mtim.tv_sec
+            || r->mtime_nsec != st->st_mtim.tv_nsec
+            || r->name_length != strlen(sources[i].name)
+            || memcmp(r + 1, sources[i].name, r->name_length) != 0)
+            problem = "stale";
+        p += source_record_size(&sources[i]);
+    }
+    if (problem == NULL && !slots_valid((const struct index_slot *) p, h->slots, h->pool_size))
+        problem = "damaged";
+    if (problem) {
+        if (verbose)
+            fprintf(stderr, "  index %s not used (%s)\n", iname, problem);
+        munmap(map, ist.st_size);
+        return 0;
+    }
+    index_slots = (const struct index_slot *) p;
+    index_pool = (const char *) (index_slots + h->slots);
+    index_mask = h->slots - 1;
+    if (verbose) {
+        for (i = 0; i < source_count; ++i) {
+            if (sources[i].mode)
+                fprintf(stderr, "%s\n", sources[i].mode);
+        }
+        fprintf(stderr, "  using index %s (%llu words)\n",
+                iname, (unsigned long long) h->words);
+    }
+    return 1;
+}
+
+/* Writes the ignore table as index, under a temporary name first so
+ * that concurrent runs never see half an index. */
+static int write_index(const char *iname)
+{
+    struct index_header h;
+    struct index_slot *slot;
+    char *records, *p, *pool, *tmpname;
+    size_t i, pool_size = 0, slots = ignore.size ? ignore.size : 1;
+    int ok = 1;
+    FILE *f;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+    h.version = INDEX_VERSION;
+    h.sources = source_count;
+    for (i = 0; i < (size_t) source_count; ++i)
+        h.sources_size += source_record_size(&sources[i]);
+    p = records = xrealloc(0, h.sources_size);
+    memset(records, 0, h.sources_size);
+    for (i = 0; i < (size_t) source_count; ++i) {
+        struct index_source *r = (struct index_source *) p;
+        const struct stat *st = &sources[i].st;
+        r->size = st->st_size;
+        r->ino = st->st_ino;
+        r->mtime_sec = st->st_mtim.tv_sec;
+        r->mtime_nsec = st->st_mtim.tv_nsec;
+        r->name_length = strlen(sources[i].name);
+        memcpy(r + 1, sources[i].name, r->name_length);
+        p += source_record_size(&sources[i]);
+    }
+
+    slot = xrealloc(0, slots * sizeof(*slot));
+    memset(slot, 0, slots * sizeof(*slot));
+    for (i = 0; i < ignore.size; ++i)
+        pool_size += ignore.slot[i].length;
+    if (pool_size > UINT32_MAX)
+        ok = 0;
+    pool = xrealloc(0, pool_size + 1);
+    for (i = 0, pool_size = 0; ok && i < ignore.size; ++i) {
+        const struct word *w = &ignore.slot[i];
+        if (w->key != NULL) {
+            slot[i].hash = w->hash;
+            slot[i].offset = pool_size;
+            slot[i].length = w->length;
+            memcpy(pool + pool_size, w->key, w->length);
+            pool_size += w->length;
+        }
+    }
+    h.slots = slots;
+    h.words = ignore.used;
+    h.pool_size = pool_size;
+    h.header_checksum = checksum(checksum(0, &h, offsetof(struct index_header, header_checksum)),
+                                 records, h.sources_size);
+
+    tmpname = xrealloc(0, strlen(iname) + 32);
+    sprintf(tmpname, "%s.%ld.tmp", iname, (long) getpid());
+    if (ok && (f = fopen(tmpname, "wb")) != NULL) {
+        ok = fwrite(&h, sizeof(h), 1, f) == 1
+             && fwrite(records, 1, h.sources_size, f) == h.sources_size
+             && fwrite(slot, sizeof(*slot), slots, f) == slots
+             && fwrite(pool, 1, pool_size, f) == pool_size;
+        if (fclose(f) != 0)
+            ok = 0;
+        if (!ok || rename(tmpname, iname) != 0) {
+            remove(tmpname);
+            ok = 0;
+        }
+    } else {
+        ok = 0;
+    }
+    if (!ok && (verbose || compile_only))
+        fprintf(stderr, "%s: can't write index %s (%s)\n", progname, iname, strerror(errno));
+    else if (ok && verbose)
+        fprintf(stderr, "  index written to %s\n", iname);
+    free(tmpname);
+    free(pool);
+    free(slot);
+    free(records);
+    return ok;
+}
+
+/* Uses the index of the ignore list, rebuilding it if necessary. A
+ * missing or unwritable cache only costs the time of reading. */
+static void load_ignore_list(void)
+{
+    char *iname = index_name();
+
+    if (iname == NULL) {
+        if (compile_only) {
+            fprintf(stderr, "%s: no cache directory, set HOME or XDG_CACHE_HOME\n", progname);
+            ++error_count;
+        }
+        read_sources();
+        return;
+    }
+    if (compile_only || !load_index(iname)) {
+        read_sources();
+        if (!write_index(iname) && compile_only)
+            ++error_count;
+    }
+    free(iname);
+}
+
+static void merge(struct table *total, const struct table *t)
+{
+    size_t i;
+    for (i = 0; i < t->size; ++i) {
+        const struct word *w = &t->slot[i];
+        if (w->key != NULL)
+            lookup(total, w->key, w->length, w->hash, 1)->count += w->count;
+    }
+}
+
+static int compare_keys(const struct word *a, const struct word *b)
+{
+    int c = memcmp(a->key, b->key, a->length < b->length ? a->length : b->length);
+    return c ? c : (a->length > b->length) - (a->length < b->length);
+}
+
+static int by_word(const void *a, const void *b)
+{
+    return compare_keys(*(const struct word *const *) a, *(const struct word *const *) b);
+}
+
+static int by_count(const void *a, const void *b)
+{
+    const struct word *s = *(const struct word *const *) a, *t = *(const struct word *const *) b;
+    if (s->count != t->count)
+        return s->count < t->count ? 1 : -1;
+    return compare_keys(s, t);
+}
+
+static void print_counts(const struct table *t)
+{
+    const struct word **list = xrealloc(0, (t->used + 1) * sizeof(*list));
+    size_t i, n = 0;
+
+    for (i = 0; i < t->size; ++i) {
+        if (t->slot[i].key != NULL)
+            list[n++] = &t->slot[i];
+    }
+    qsort(list, n, sizeof(*list), by_frequency ? by_count : by_word);
+    for (i = 0; i < n; ++i)
+        printf("%5ld %s\n", list[i]->count, list[i]->key);
+    free(list);
+}
+
+int main(int argc, char *argv[])
+{
+    int german = 0, english = 0, i, started;
+    const char *ignore_list = NULL;
+    struct table total, *tables;
+    pthread_t *pool;
+#ifdef __unix__
+    char *ptmp;
+    progname = argv[0];
+    if ((ptmp = strrchr(progname, '/')))
+        progname = ptmp + 1;
+#endif
+
+    for (--argc, ++argv; argc > 0 && **argv == '-' && argv[0][1]; --argc, ++argv) {
+        if (strcmp(*argv, "--") == 0) {
+            --argc;
+            ++argv;
+            break;
+        }
+        while (*++*argv) {
+            switch (**argv) {
+                case 'c':
+                    compile_only = 1;
+                    break;
+                case 'd':
+                    german = 1;
+                    break;
+                case 'e':
+                    english = 1;
+                    break;
+                case 'h':
+                case '?':
+                    usage();
+                    return EXIT_SUCCESS;
+                case 'j':
+                    if (*++*argv || --argc && *++argv)
+                        threads = atoi(*argv);
+                    else
+                        arg_err('j');
+                    goto nextarg;
+                case 'n':
+                    by_frequency = 1;
+                    break;
+                case 'v':
+                    verbose = 1;
+                    break;
+                case 'w':
+                    if (*++*argv || --argc && *++argv)
+                        ignore_list = *argv;
+                    else
+                        arg_err('w');
+                    goto nextarg;
+                default:
+                    fprintf(stderr, "%s: unknown command line flag '%c'.\n",
+                            progname, **argv);
+                    usage();
+                    return EXIT_FAILURE;
+            }
+        }
+        nextarg: ;
+    }
+
+    init_classes();
+    if (german)
+        add_dicts(german_dicts, "German mode");
+    if (english)
+        add_dicts(english_dicts, "English mode");
+    if (ignore_list)
+        add_ignore_list(ignore_list, "Processing ignore files");
+    if (compile_only && source_count == 0) {
+        fprintf(stderr, "%s: option -c requires -d, -e or -w.\n", progname);
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (source_count > 0)
+        load_ignore_list();
+    if (compile_only)
+        return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+    if (verbose) {
+        fputs("Now processing files:", stderr);
+        for (i = 0; i < argc; ++i)
+            fprintf(stderr, "%s%s", i ? " " : " ", argv[i]);
+        fputs(i ? "\n" : " \n", stderr);
+    }
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int) cpus : 1;
+    }
+    queue_max = 2 * threads;
+    tables = xrealloc(0, threads * sizeof(*tables));
+    memset(tables, 0, threads * sizeof(*tables));
+    pool = xrealloc(0, threads * sizeof(*pool));
+    for (started = 0; started < threads; ++started) {
+        if (pthread_create(&pool[started], 0, worker, &tables[started]) != 0)
+            break;
+    }
+    if (started == 0) {
+        fprintf(stderr, "%s: can't start threads\n", progname);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < argc; ++i)
+        do_file(argv[i]);
+    if (argc == 0)
+        do_handle(STDIN_FILENO, "stdin");
+
+    pthread_mutex_lock(&lock);
+    input_done = 1;
+    pthread_cond_broadcast(&not_empty);
+    pthread_mutex_unlock(&lock);
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < started; ++i) {
+        pthread_join(pool[i], 0);
+        merge(&total, &tables[i]);
+    }
+    print_counts(&total);
+
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,917 @@
+/* File: toolbench.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Benchmark of the tools in Text and hdump. Deterministic synthetic
+ * corpora are generated once into a directory and reused by later runs:
+ * random binary data, a sparse file of zeros, English prose, JSON with
+ * long lines, prose with CRLF line ends and pdf2text-like output with
+ * page breaks and hyphenation. Every tool runs in its modes on the
+ * corpora which suit it, the best of several runs is reported with
+ * MB/s, lines/s, CPU time and peak RSS. The page cache is warm after
+ * the first run, except for the cases with direct I/O (-D).
+ *
+ * Option -o saves the results as a baseline. A later run with -b
+ * compares with it and flags every case which got slower, needed more
+ * CPU time or more memory beyond the threshold (-t); the exit status is
+ * 1 then. */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define CORPUS_VERSION 1        /* part of the file names, raise it if a
+                                   generator changes its output */
+#define OUT_BLOCK   1048576
+#define NEEDLE_SIZE 4096        /* FILE1 of the contains cases */
+#define MAX_SIZES   8
+#define MAX_FILTERS 32
+
+/* corpus kinds, the cases name the ones they run on */
+#define RANDOM  1
+#define ZEROS   2
+#define PROSE   4
+#define JSON    8
+#define CRLF    16
+#define PDFTEXT 32
+#define TEXT    (PROSE | JSON | CRLF | PDFTEXT)
+#define ALL     (RANDOM | ZEROS | TEXT)
+
+/* how the corpus is given to the tool */
+#define ARG     0               /* as file argument */
+#define STDIN   1               /* as standard input */
+#define SEQ     2               /* contains sampled-bytes FILE2 */
+#define SUB     3               /* contains piece-of-the-end FILE2 */
+
+struct out {
+    FILE *f;
+    unsigned char *buf;
+    size_t used;
+    uint64_t left;              /* bytes still to generate */
+    uint64_t lines;
+    int column;
+    int page_line;
+    unsigned long page;
+    int error;
+};
+
+struct style {
+    const char *eol;
+    size_t width;
+    int hyphenate;
+    int page_lines;             /* 0: no pages */
+};
+
+struct corpus {
+    int kind;
+    const char *name;
+    void (*generate)(struct out *o, const struct style *st);
+    const struct style *style;
+};
+
+struct bench_case {
+    const char *name;
+    const char *tool;           /* below the root of the tree */
+    const char *args[3];
+    int corpora;
+    int input;
+};
+
+struct result {
+    char name[64];
+    char corpus[16];
+    uint64_t size;
+    double mbps;
+    double cpu;
+    long rss;                   /* KiB */
+};
+
+static const struct style prose_style = {"\n", 72, 0, 0};
+static const struct style crlf_style = {"\r\n", 72, 0, 0};
+static const struct style pdftext_style = {"\n", 64, 1, 50};
+
+static void gen_random(struct out *o, const struct style *st);
+static void gen_zeros(struct out *o, const struct style *st);
+static void gen_text(struct out *o, const struct style *st);
+static void gen_json(struct out *o, const struct style *st);
+
+static const struct corpus corpora[] = {
+    {RANDOM,  "random",  gen_random, 0},
+    {ZEROS,   "zeros",   gen_zeros,  0},
+    {PROSE,   "prose",   gen_text,   &prose_style},
+    {JSON,    "json",    gen_json,   0},
+    {CRLF,    "crlf",    gen_text,   &crlf_style},
+    {PDFTEXT, "pdftext", gen_text,   &pdftext_style},
+};
+#define CORPORA (sizeof(corpora) / sizeof(corpora[0]))
+
+static const struct bench_case cases[] = {
+    {"hdump",          "hdump/hdump",       {0},          ALL,                      ARG},
+    {"hdump -D",       "hdump/hdump",       {"-D"},       RANDOM | ZEROS,           ARG},
+    {"charstat",       "Text/charstat",     {0},          ALL,                      ARG},
+    {"charstat -D",    "Text/charstat",     {"-D"},       RANDOM,                   ARG},
+    {"linelengths",    "Text/linelengths",  {0},          TEXT,                     ARG},
+    {"linelengths -s", "Text/linelengths",  {"-s"},       TEXT,                     ARG},
+    {"joinlines",      "Text/joinlines",    {0},          PROSE | CRLF | PDFTEXT,   STDIN},
+    {"contains",       "Text/contains",     {"-q"},       RANDOM | TEXT,            SEQ},
+    {"contains -s",    "Text/contains",     {"-q", "-s"}, RANDOM | TEXT,            SUB},
+    {"squeeze",        "Text/squeeze",      {0},          PROSE | CRLF | PDFTEXT,   ARG},
+    {"wordcount",      "Text/wordcount",    {0},          PROSE | PDFTEXT,          ARG},
+    {"textprof",       "Text/textprof",     {0},          TEXT,                     ARG},
+    {"textprof -wu",   "Text/textprof",     {"-w", "-u"}, TEXT,                     ARG},
+};
+#define CASES (sizeof(cases) / sizeof(cases[0]))
+
+static const char *const words[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as",
+    "was", "with", "be", "by", "on", "not", "he", "this", "are", "or",
+    "his", "from", "at", "which", "but", "have", "an", "had", "they",
+    "you", "were", "their", "one", "all", "we", "can", "her", "has",
+    "there", "been", "if", "more", "when", "will", "would", "who", "so",
+    "no", "time", "people", "year", "way", "day", "man", "thing",
+    "woman", "life", "child", "world", "school", "state", "family",
+    "student", "group", "country", "problem", "hand", "part", "place",
+    "case", "week", "company", "system", "program", "question", "work",
+    "government", "number", "night", "point", "home", "water", "room",
+    "mother", "area", "money", "story", "fact", "month", "right",
+    "study", "book", "job", "word", "business", "issue", "side", "kind",
+    "head", "house", "service", "friend", "father", "power", "hour",
+    "game", "line", "member", "law", "city", "community", "name",
+    "president", "team", "minute", "idea", "body", "information",
+    "parent", "face", "level", "office", "door", "health", "person",
+    "history", "party", "result", "change", "morning", "reason",
+    "research", "moment", "teacher", "force", "education", "although",
+    "understanding", "particularly", "development", "environmental",
+};
+#define WORDS (sizeof(words) / sizeof(words[0]))
+
+static int error_count = 0;
+static int verbose = 0;
+static int repetitions = 3;
+static double threshold = 10.0;
+static const char *root = "..";
+static const char *corpus_dir;
+static uint64_t sizes[MAX_SIZES];
+static int size_count = 0;
+static const char *case_filters[MAX_FILTERS], *corpus_filters[MAX_FILTERS];
+static int case_filter_count = 0, corpus_filter_count = 0;
+static struct result *baseline, *results;
+static size_t baseline_count, result_count, result_max;
+static uint64_t rng_state;
+#ifdef __unix__
+static char *progname;
+#else
+static const char *const progname = "toolbench";
+#endif
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: %s [-b baseline] [-d dir] [-n runs] [-o file] [-r root]\n"
+            "                 [-s size[kmg]]... [-t percent] [-v] [case|corpus]...\n",
+            progname);
+    fprintf(stderr, "  -b   compare with the results saved in baseline\n"
+                    "  -d   directory of the corpora, default $TMPDIR/toolbench\n"
+                    "  -n   runs of every case, the best one counts (3)\n"
+                    "  -o   save the results as a baseline in file\n"
+                    "  -r   root of the tree with Text and hdump (..)\n"
+                    "  -s   corpus size, may be given several times (64m)\n"
+                    "  -t   threshold of regressions in percent (10)\n"
+                    "  -v   print the commands\n");
+}
+
+static void arg_err(char c)
+{
+    fprintf(stderr, "%s: option -%c requires an argument.\n", progname, c);
+    usage();
+    exit(EXIT_FAILURE);
+}
+
+static void *xrealloc(void *p, size_t size)
+{
+    if ((p = realloc(p, size)) == NULL && size > 0) {
+        fprintf(stderr, "%s: out of memory\n", progname);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* xorshift64*, seeded per corpus so that every corpus is the same on
+   every machine and a smaller one is a prefix of a larger one */
+static uint64_t rng(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+static uint64_t parse_size(const char *s)
+{
+    char *end;
+    uint64_t n = strtoull(s, &end, 10);
+
+    switch (tolower((unsigned char) *end)) {
+        case 't': n <<= 10;
+            /* fall through */
+        case 'g': n <<= 10;
+            /* fall through */
+        case 'm': n <<= 10;
+            /* fall through */
+        case 'k': n <<= 10;
+            ++end;
+    }
+    if (*end || n == 0) {
+        fprintf(stderr, "%s: bad size %s\n", progname, s);
+        exit(EXIT_FAILURE);
+    }
+    return n;
+}
+
+static const char *format_size(uint64_t n)
+{
+    static char s[32];
+    const char *units = "kmgt";
+    int u = -1;
+
+    while (u < 3 && n >= 1024 && n % 1024 == 0) {
+        n >>= 10;
+        ++u;
+    }
+    if (u < 0)
+        sprintf(s, "%llu", (unsigned long long) n);
+    else
+        sprintf(s, "%llu%c", (unsigned long long) n, units[u]);
+    return s;
+}
+
+/* ---- corpus generation ---- */
+
+static void flush_out(struct out *o)
+{
+    const unsigned char *p = o->buf, *end = o->buf + o->used;
+
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+        ++o->lines;
+        ++p;
+    }
+    if (fwrite(o->buf, 1, o->used, o->f) != o->used && !o->error)
+        o->error = errno;
+    o->used = 0;
+}
+
+/* Appends n bytes, returns 0 when the corpus is complete. */
+static int put(struct out *o, const void *data, size_t n)
+{
+    const unsigned char *p = data;
+
+    while (n > 0 && o->left > 0) {
+        size_t k = OUT_BLOCK - o->used;
+        if (k > n)
+            k = n;
+        if (k > o->left)
+            k = o->left;
+        memcpy(o->buf + o->used, p, k);
+        o->used += k;
+        o->left -= k;
+        p += k;
+        n -= k;
+        if (o->used == OUT_BLOCK)
+            flush_out(o);
+    }
+    return o->left > 0;
+}
+
+static int put_string(struct out *o, const char *s)
+{
+    return put(o, s, strlen(s));
+}
+
+static void gen_random(struct out *o, const struct style *st)
+{
+    uint64_t block[512];
+    int i;
+
+    (void) st;
+    do {
+        for (i = 0; i < 512; ++i)
+            block[i] = rng();
+    } while (put(o, block, sizeof(block)));
+}
+
+/* Holes with a small record of data every MiB, so the file takes
+   hardly any space. */
+static void gen_zeros(struct out *o, const struct style *st)
+{
+    uint64_t size = o->left, pos, record[8];
+    int i;
+
+    (void) st;
+    for (pos = 0; pos + sizeof(record) <= size; pos += OUT_BLOCK) {
+        for (i = 0; i < 8; ++i)
+            record[i] = rng();
+        if (fseeko(o->f, pos, SEEK_SET) != 0
+            || fwrite(record, sizeof(record), 1, o->f) != 1) {
+            o->error = errno;
+            return;
+        }
+    }
+    if (fflush(o->f) != 0 || ftruncate(fileno(o->f), size) != 0)
+        o->error = errno;
+    o->left = 0;
+}
+
+/* Zipf-like: the short common words at the start of the list are
+   chosen much more often. */
+static const char *random_word(void)
+{
+    uint64_t a = rng() % WORDS, b = rng() % WORDS;
+    return words[a * b / WORDS];
+}
+
+static void end_line(struct out *o, const struct style *st)
+{
+    put_string(o, st->eol);
+    o->column = 0;
+    if (st->page_lines && ++o->page_line == st->page_lines) {
+        char s[64];
+        sprintf(s, "%s%30s%lu%s\f", st->eol, "", ++o->page, st->eol);
+        put_string(o, s);
+        o->page_line = 0;
+    }
+}
+
+static void put_word(struct out *o, const char *w, size_t n, const struct style *st)
+{
+    if (o->column > 0) {
+        if (o->column + 1 + n <= st->width) {
+            put(o, " ", 1);
+            ++o->column;
+        } else if (st->hyphenate && n >= 6 && (size_t) o->column + 5 < st->width) {
+            size_t k = st->width - o->column - 2;
+            if (k > n - 3)
+                k = n - 3;
+            put(o, " ", 1);
+            put(o, w, k);
+            put(o, "-", 1);
+            end_line(o, st);
+            w += k;
+            n -= k;
+        } else {
+            end_line(o, st);
+        }
+    }
+    put(o, w, n);
+    o->column += n;
+}
+
+static void put_sentence(struct out *o, const struct style *st)
+{
+    int n = 6 + rng() % 15, i;
+
+    for (i = 0; i < n && o->left > 0; ++i) {
+        char w[32];
+        size_t len;
+        strcpy(w, random_word());
+        len = strlen(w);
+        if (i == 0)
+            w[0] = toupper((unsigned char) w[0]);
+        if (i == n - 1)
+            w[len++] = ".....!?"[rng() % 7];
+        else if (rng() % 8 == 0)
+            w[len++] = ',';
+        put_word(o, w, len, st);
+    }
+}
+
+static void gen_text(struct out *o, const struct style *st)
+{
+    while (o->left > 0) {
+        int n = 3 + rng() % 6;
+        while (n-- > 0 && o->left > 0)
+            put_sentence(o, st);
+        end_line(o, st);
+        end_line(o, st);
+    }
+}
+
+/* One record per line, lines of about 1 KiB up to 200 KiB. */
+static void gen_json(struct out *o, const struct style *st)
+{
+    unsigned long long id = 0;
+    char s[64];
+    int n, i;
+
+    (void) st;
+    while (o->left > 0) {
+        n = 100 + rng() % 20000;
+        sprintf(s, "{\"id\":%llu,\"name\":\"%s %s\",\"values\":[",
+                ++id, random_word(), random_word());
+        put_string(o, s);
+        for (i = 0; i < n && o->left > 0; ++i) {
+            sprintf(s, i ? ",%u" : "%u", (unsigned) (rng() % 100000));
+            put_string(o, s);
+        }
+        put_string(o, "],\"tags\":[");
+        for (i = 0; i < n / 10 && o->left > 0; ++i) {
+            sprintf(s, i ? ",\"%s\"" : "\"%s\"", random_word());
+            put_string(o, s);
+        }
+        put_string(o, "]}\n");
+    }
+}
+
+static char *corpus_path(const struct corpus *c, uint64_t size, const char *suffix)
+{
+    static char path[4][4096];
+    static int next = 0;
+    char *p = path[next++ % 4];
+
+    snprintf(p, sizeof(path[0]), "%s/%s-%s.v%d%s", corpus_dir, c->name,
+             format_size(size), CORPUS_VERSION, suffix);
+    return p;
+}
+
+/* FILE1 of contains: every size/NEEDLE_SIZE-th byte of the corpus, a
+   subsequence found only at its end, and the last bytes but one block,
+   a substring. */
+static int write_needles(const struct corpus *c, uint64_t size)
+{
+    unsigned char seq[NEEDLE_SIZE], sub[NEEDLE_SIZE];
+    const uint64_t step = size / NEEDLE_SIZE ? size / NEEDLE_SIZE : 1;
+    size_t n = size < NEEDLE_SIZE ? size : NEEDLE_SIZE, i;
+    const char *path = corpus_path(c, size, "");
+    FILE *f;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return 0;
+    for (i = 0; i < n; ++i) {
+        if (pread(fd, &seq[i], 1, (size - 1) - (n - 1 - i) * step) != 1)
+            break;
+    }
+    if (i < n || pread(fd, sub, n, size >= 2 * n ? size - 2 * n : 0) != (ssize_t) n) {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    if ((f = fopen(corpus_path(c, size, ".seq"), "wb")) == NULL)
+        return 0;
+    if (fwrite(seq, 1, n, f) != n) {
+        fclose(f);
+        return 0;
+    }
+    if (fclose(f) != 0 || (f = fopen(corpus_path(c, size, ".sub"), "wb")) == NULL)
+        return 0;
+    if (fwrite(sub, 1, n, f) != n) {
+        fclose(f);
+        return 0;
+    }
+    return fclose(f) == 0;
+}
+
+/* Generates the corpus unless it is already there. The info file is
+   written last and holds size and lines, so an interrupted generation
+   is redone. Returns 0 if the corpus can't be used. */
+static int prepare_corpus(const struct corpus *c, uint64_t size, uint64_t *lines)
+{
+    const char *path = corpus_path(c, size, "");
+    const char *info = corpus_path(c, size, ".info");
+    unsigned long long isize, ilines;
+    struct statvfs vfs;
+    struct stat st;
+    struct out o;
+    FILE *f;
+
+    if ((f = fopen(info, "r")) != NULL) {
+        int ok = fscanf(f, "%llu %llu", &isize, &ilines) == 2 && isize == size
+                 && stat(path, &st) == 0 && (uint64_t) st.st_size == size;
+        fclose(f);
+        if (ok) {
+            *lines = ilines;
+            return 1;
+        }
+    }
+
+    if (c->kind != ZEROS && statvfs(corpus_dir, &vfs) == 0
+        && (uint64_t) vfs.f_bavail * vfs.f_frsize < size + (size >> 4)) {
+        fprintf(stderr, "%s: not enough space in %s for %s-%s\n",
+                progname, corpus_dir, c->name, format_size(size));
+        return 0;
+    }
+    fprintf(stderr, "%s: generating %s\n", progname, path);
+    if ((f = fopen(path, "wb")) == NULL) {
+        fprintf(stderr, "%s: can't create %s (%s)\n", progname, path, strerror(errno));
+        ++error_count;
+        return 0;
+    }
+    memset(&o, 0, sizeof(o));
+    o.f = f;
+    o.buf = xrealloc(NULL, OUT_BLOCK);
+    o.left = size;
+    rng_state = 0x9e3779b97f4a7c15ULL * (unsigned) c->kind;
+    c->generate(&o, c->style);
+    flush_out(&o);
+    free(o.buf);
+    if (fclose(f) != 0 && !o.error)
+        o.error = errno;
+    if (o.error || (c->kind != ZEROS && !write_needles(c, size))) {
+        fprintf(stderr, "%s: write error on %s (%s)\n", progname, path,
+                strerror(o.error ? o.error : errno));
+        ++error_count;
+        unlink(path);
+        return 0;
+    }
+    if ((f = fopen(info, "w")) == NULL
+        || fprintf(f, "%llu %llu\n", (unsigned long long) size,
+                   (unsigned long long) o.lines) < 0
+        || fclose(f) != 0) {
+        fprintf(stderr, "%s: can't write %s (%s)\n", progname, info, strerror(errno));
+        ++error_count;
+        return 0;
+    }
+    *lines = o.lines;
+    return 1;
+}
+
+/* ---- running the tools ---- */
+
+/* One run with the standard output to /dev/null. Returns 0 if the tool
+   failed, else wall and CPU time in seconds and the peak RSS in KiB. */
+static int run_once(char *const argv[], const char *input,
+                    double *wall, double *cpu, long *rss)
+{
+    struct timespec t0, t1;
+    struct rusage ru;
+    int status;
+    pid_t pid;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if ((pid = fork()) < 0) {
+        fprintf(stderr, "%s: can't fork (%s)\n", progname, strerror(errno));
+        return 0;
+    }
+    if (pid == 0) {
+        int in = open(input ? input : "/dev/null", O_RDONLY);
+        int out = open("/dev/null", O_WRONLY);
+        if (in < 0 || out < 0 || dup2(in, STDIN_FILENO) < 0 || dup2(out, STDOUT_FILENO) < 0)
+            _exit(127);
+        execv(argv[0], argv);
+        fprintf(stderr, "%s: can't run %s (%s)\n", progname, argv[0], strerror(errno));
+        _exit(127);
+    }
+    while (wait4(pid, &status, 0, &ru) < 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "%s: wait failed (%s)\n", progname, strerror(errno));
+            return 0;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        if (WIFSIGNALED(status))
+            fprintf(stderr, "%s: %s killed by signal %d\n", progname, argv[0], WTERMSIG(status));
+        else
+            fprintf(stderr, "%s: %s failed with status %d\n", progname, argv[0],
+                    WEXITSTATUS(status));
+        return 0;
+    }
+    *wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    *cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+           + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    *rss = ru.ru_maxrss;
+    return 1;
+}
+
+static const struct result *find_baseline(const struct result *r)
+{
+    size_t i;
+
+    for (i = 0; i < baseline_count; ++i) {
+        if (baseline[i].size == r->size && strcmp(baseline[i].name, r->name) == 0
+            && strcmp(baseline[i].corpus, r->corpus) == 0)
+            return &baseline[i];
+    }
+    return NULL;
+}
+
+/* The verdict against the baseline. Differences below 10 ms of CPU time
+   and 1 MiB of memory are noise. */
+static const char *compare(const struct result *r)
+{
+    static char s[128];
+    const struct result *b = find_baseline(r);
+    const double t = threshold / 100;
+    int n;
+
+    if (b == NULL)
+        return "";
+    n = sprintf(s, "%+5.1f%%", b->mbps > 0 ? (r->mbps / b->mbps - 1) * 100 : 0.0);
+    if (r->mbps < b->mbps * (1 - t)) {
+        n += sprintf(s + n, " SLOWER");
+        ++error_count;
+    }
+    if (r->cpu > b->cpu * (1 + t) && r->cpu - b->cpu > 0.01) {
+        n += sprintf(s + n, " MORE CPU");
+        ++error_count;
+    }
+    if (r->rss > b->rss * (1 + t) && r->rss - b->rss > 1024) {
+        n += sprintf(s + n, " MORE MEMORY");
+        ++error_count;
+    }
+    return s;
+}
+
+static void run_case(const struct bench_case *bc, const struct corpus *c,
+                     uint64_t size, uint64_t lines)
+{
+    char tool[4096];
+    char *argv[8];
+    const char *input = NULL;
+    double wall, cpu, best_wall = 0, best_cpu = 0;
+    long rss, max_rss = 0;
+    struct result *r;
+    int argc = 0, i;
+
+    snprintf(tool, sizeof(tool), "%s/%s", root, bc->tool);
+    argv[argc++] = tool;
+    for (i = 0; i < 3 && bc->args[i]; ++i)
+        argv[argc++] = (char *) bc->args[i];
+    switch (bc->input) {
+        case ARG:
+            argv[argc++] = corpus_path(c, size, "");
+            break;
+        case STDIN:
+            input = corpus_path(c, size, "");
+            break;
+        case SEQ:
+        case SUB:
+            argv[argc++] = corpus_path(c, size, bc->input == SEQ ? ".seq" : ".sub");
+            argv[argc++] = corpus_path(c, size, "");
+            break;
+    }
+    argv[argc] = NULL;
+    if (verbose) {
+        for (i = 0; i < argc; ++i)
+            fprintf(stderr, "%s%s", i ? " " : "", argv[i]);
+        fprintf(stderr, input ? " < %s\n" : "\n", input);
+    }
+
+    for (i = 0; i < repetitions; ++i) {
+        if (!run_once(argv, input, &wall, &cpu, &rss)) {
+            printf("%-16s %-8s %6s  failed\n", bc->name, c->name, format_size(size));
+            ++error_count;
+            return;
+        }
+        if (i == 0 || wall < best_wall) {
+            best_wall = wall;
+            best_cpu = cpu;
+        }
+        if (rss > max_rss)
+            max_rss = rss;
+    }
+    if (best_wall <= 0)
+        best_wall = 1e-6;
+
+    if (result_count == result_max) {
+        result_max = result_max ? 2 * result_max : 64;
+        results = xrealloc(results, result_max * sizeof(*results));
+    }
+    r = &results[result_count++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", bc->name);
+    snprintf(r->corpus, sizeof(r->corpus), "%s", c->name);
+    r->size = size;
+    r->mbps = size / 1048576.0 / best_wall;
+    r->cpu = best_cpu;
+    r->rss = max_rss;
+    printf("%-16s %-8s %6s %9.1f ", r->name, r->corpus, format_size(size), r->mbps);
+    if (c->kind & TEXT)
+        printf("%9.0f ", lines / 1e3 / best_wall);
+    else
+        printf("%9s ", "-");
+    printf("%8.2f %8.2f %8.1f  %s\n", best_wall, r->cpu, r->rss / 1024.0, compare(r));
+    fflush(stdout);
+}
+
+/* ---- baselines ---- */
+
+static void load_baseline(const char *fname)
+{
+    char line[512];
+    FILE *f;
+
+    if ((f = fopen(fname, "r")) == NULL) {
+        fprintf(stderr, "%s: can't open %s (%s)\n", progname, fname, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        struct result r;
+        unsigned long long size;
+        char *name, *corpus, *rest;
+        if (line[0] == '#' || (name = strtok(line, "\t")) == NULL
+            || (corpus = strtok(NULL, "\t")) == NULL || (rest = strtok(NULL, "\n")) == NULL)
+            continue;
+        memset(&r, 0, sizeof(r));
+        if (sscanf(rest, "%llu %lf %lf %ld", &size, &r.mbps, &r.cpu, &r.rss) != 4)
+            continue;
+        snprintf(r.name, sizeof(r.name), "%s", name);
+        snprintf(r.corpus, sizeof(r.corpus), "%s", corpus);
+        r.size = size;
+        baseline = xrealloc(baseline, (baseline_count + 1) * sizeof(*baseline));
+        baseline[baseline_count++] = r;
+    }
+    fclose(f);
+}
+
+static void save_results(const char *fname)
+{
+    FILE *f;
+    size_t i;
+
+    if ((f = fopen(fname, "w")) == NULL) {
+        fprintf(stderr, "%s: can't create %s (%s)\n", progname, fname, strerror(errno));
+        ++error_count;
+        return;
+    }
+    fprintf(f, "# toolbench results: case, corpus, bytes, MB/s, CPU seconds, RSS KiB\n");
+    for (i = 0; i < result_count; ++i) {
+        const struct result *r = &results[i];
+        fprintf(f, "%s\t%s\t%llu\t%.2f\t%.4f\t%ld\n", r->name, r->corpus,
+                (unsigned long long) r->size, r->mbps, r->cpu, r->rss);
+    }
+    if (fclose(f) != 0) {
+        fprintf(stderr, "%s: write error on %s (%s)\n", progname, fname, strerror(errno));
+        ++error_count;
+    }
+}
+
+static int selected(const char *name, const char *const *filters, int n, int prefix)
+{
+    int i;
+
+    if (n == 0)
+        return 1;
+    for (i = 0; i < n; ++i) {
+        if (prefix ? strncmp(name, filters[i], strlen(filters[i])) == 0
+                   : strcmp(name, filters[i]) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *baseline_name = NULL, *output_name = NULL;
+    char default_dir[4096];
+    uint64_t lines[CORPORA];
+    int ready[CORPORA];
+    int s, used;
+    size_t i, k;
+#ifdef __unix__
+    char *ptmp;
+    progname = argv[0];
+    if ((ptmp = strrchr(progname, '/')))
+        progname = ptmp + 1;
+#endif
+
+    for (--argc, ++argv; argc > 0; --argc, ++argv) {
+        if (**argv == '-') {
+            while (*++*argv) {
+                switch (**argv) {
+                    case 'b':
+                        if (*++*argv || --argc && *++argv)
+                            baseline_name = *argv;
+                        else
+                            arg_err('b');
+                        goto nextarg;
+                    case 'd':
+                        if (*++*argv || --argc && *++argv)
+                            corpus_dir = *argv;
+                        else
+                            arg_err('d');
+                        goto nextarg;
+                    case 'h':
+                    case '?':
+                        usage();
+                        return EXIT_SUCCESS;
+                    case 'n':
+                        if (*++*argv || --argc && *++argv)
+                            repetitions = atoi(*argv) > 0 ? atoi(*argv) : 1;
+                        else
+                            arg_err('n');
+                        goto nextarg;
+                    case 'o':
+                        if (*++*argv || --argc && *++argv)
+                            output_name = *argv;
+                        else
+                            arg_err('o');
+                        goto nextarg;
+                    case 'r':
+                        if (*++*argv || --argc && *++argv)
+                            root = *argv;
+                        else
+                            arg_err('r');
+                        goto nextarg;
+                    case 's':
+                        if (*++*argv || --argc && *++argv) {
+                            if (size_count == MAX_SIZES) {
+                                fprintf(stderr, "%s: too many sizes.\n", progname);
+                                return EXIT_FAILURE;
+                            }
+                            sizes[size_count++] = parse_size(*argv);
+                        } else
+                            arg_err('s');
+                        goto nextarg;
+                    case 't':
+                        if (*++*argv || --argc && *++argv)
+                            threshold = atof(*argv);
+                        else
+                            arg_err('t');
+                        goto nextarg;
+                    case 'v':
+                        verbose = 1;
+                        break;
+                    default:
+                        fprintf(stderr, "%s: unknown command line flag '%c'.\n",
+                                progname, **argv);
+                        usage();
+                        return EXIT_FAILURE;
+                }
+            }
+        } else {
+            for (i = 0; i < CORPORA && strcmp(*argv, corpora[i].name) != 0; ++i)
+                ;
+            if (case_filter_count == MAX_FILTERS || corpus_filter_count == MAX_FILTERS) {
+                fprintf(stderr, "%s: too many cases.\n", progname);
+                return EXIT_FAILURE;
+            }
+            if (i < CORPORA)
+                corpus_filters[corpus_filter_count++] = *argv;
+            else
+                case_filters[case_filter_count++] = *argv;
+        }
+        nextarg: ;
+    }
+    if (size_count == 0)
+        sizes[size_count++] = 64 << 20;
+    if (corpus_dir == NULL) {
+        const char *tmp = getenv("TMPDIR");
+        snprintf(default_dir, sizeof(default_dir), "%s/toolbench", tmp && *tmp ? tmp : "/tmp");
+        corpus_dir = default_dir;
+    }
+    if (mkdir(corpus_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "%s: can't create %s (%s)\n", progname, corpus_dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (baseline_name)
+        load_baseline(baseline_name);
+
+    for (s = 0; s < size_count; ++s) {
+        /* all corpora first, so that generating them doesn't disturb
+           the measurements */
+        for (k = 0; k < CORPORA; ++k) {
+            used = 0;
+            for (i = 0; i < CASES; ++i) {
+                if (cases[i].corpora & corpora[k].kind
+                    && selected(cases[i].name, case_filters, case_filter_count, 1))
+                    used = 1;
+            }
+            ready[k] = used && selected(corpora[k].name, corpus_filters, corpus_filter_count, 0)
+                       && prepare_corpus(&corpora[k], sizes[s], &lines[k]);
+        }
+        if (s == 0)
+            printf("%-16s %-8s %6s %9s %9s %8s %8s %8s\n", "case", "corpus", "size",
+                   "MB/s", "klines/s", "wall s", "CPU s", "RSS MiB");
+        for (i = 0; i < CASES; ++i) {
+            char tool[4096];
+            if (!selected(cases[i].name, case_filters, case_filter_count, 1))
+                continue;
+            snprintf(tool, sizeof(tool), "%s/%s", root, cases[i].tool);
+            if (access(tool, X_OK) != 0) {
+                if (s == 0)
+                    fprintf(stderr, "%s: %s not built, skipped\n", progname, tool);
+                continue;
+            }
+            for (k = 0; k < CORPORA; ++k) {
+                if (ready[k] && cases[i].corpora & corpora[k].kind)
+                    run_case(&cases[i], &corpora[k], sizes[s], lines[k]);
+            }
+        }
+    }
+
+    if (output_name)
+        save_results(output_name);
+    return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
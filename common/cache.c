@@ -0,0 +1,641 @@
+/* File: cache.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* See cache.h. The file holds a header, the slots of an open addressing
+ * table and the records. A slot has the hash of the key and the offset
+ * of the newest record of that key. A record is appended and the header
+ * written before the slot, so a run which is killed in between leaves at
+ * most a record no slot points to; records are checked against their
+ * checksum anyway. The file only grows while it is in use, so a mapping
+ * made under the lock never reaches beyond its end. */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#endif
+
+#include "cache.h"
+
+#define CACHE_MAGIC   "RESULTS\n"
+#define CACHE_VERSION 1
+#define CACHE_SLOTS   1024      /* initial size, a power of two */
+
+int cache_enabled = 0;
+
+#ifdef __unix__
+
+struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t slots;             /* a power of two */
+    uint64_t used;
+    uint64_t end;               /* end of the records */
+    uint64_t checksum;          /* of the fields above */
+};
+
+/* offset 0 marks an empty slot. */
+struct cache_slot {
+    uint64_t hash;
+    uint64_t offset;
+};
+
+struct cache_key {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    char tool[24];
+    char options[40];
+};
+
+/* Followed by the path and the data, each padded with zeros to a
+ * multiple of 8. The checksum covers the key and both. */
+struct cache_record {
+    struct cache_key key;
+    uint32_t path_length;
+    uint32_t data_length;
+    uint64_t checksum;
+};
+
+static const char *cache_progname = "cache";
+static char *cache_name;
+static int cache_fd = -1;
+static unsigned char *cache_map;
+static size_t cache_size;
+
+static uint64_t checksum(uint64_t h, const void *data, size_t n)
+{
+    const unsigned char *p = data;
+    if (h == 0)
+        h = 14695981039346656037ULL;
+    while (n-- > 0)
+        h = (h ^ *p++) * 1099511628211ULL;
+    return h;
+}
+
+static uint64_t header_checksum(const struct cache_header *h)
+{
+    return checksum(0, h, offsetof(struct cache_header, checksum));
+}
+
+static size_t padded(size_t n)
+{
+    return (n + 7) / 8 * 8;
+}
+
+static size_t record_size(const struct cache_record *r)
+{
+    return sizeof(*r) + padded(r->path_length + 1) + padded(r->data_length);
+}
+
+static uint64_t record_checksum(const struct cache_record *r)
+{
+    return checksum(checksum(0, &r->key, sizeof(r->key)), r + 1,
+                    padded(r->path_length + 1) + padded(r->data_length));
+}
+
+static uint64_t records_start(uint64_t slots)
+{
+    return sizeof(struct cache_header) + slots * sizeof(struct cache_slot);
+}
+
+static const char *cache_path(void)
+{
+    const char *env = getenv("RESULT_CACHE"), *cache = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+
+    if (cache_name != NULL)
+        return cache_name;
+    if (env != NULL && *env) {
+        cache_name = strdup(env);
+    } else if (cache != NULL && *cache) {
+        if ((cache_name = malloc(strlen(cache) + 16)) != NULL) {
+            mkdir(cache, 0700);
+            sprintf(cache_name, "%s/toolresults", cache);
+        }
+    } else if (home != NULL && *home) {
+        if ((cache_name = malloc(strlen(home) + 24)) != NULL) {
+            sprintf(cache_name, "%s/.cache", home);
+            mkdir(cache_name, 0700);
+            strcat(cache_name, "/toolresults");
+        }
+    }
+    return cache_name;
+}
+
+/* Returns -1 if tool or options don't fit, cutting them off could give
+   two different results the same key. */
+static int make_key(struct cache_key *k, const struct stat *st, const char *tool,
+                    const char *options)
+{
+    size_t tool_length = strlen(tool), options_length = strlen(options);
+
+    if (tool_length >= sizeof(k->tool) || options_length >= sizeof(k->options))
+        return -1;
+    memset(k, 0, sizeof(*k));
+    k->dev = st->st_dev;
+    k->ino = st->st_ino;
+    k->size = st->st_size;
+    k->mtime_sec = st->st_mtim.tv_sec;
+    k->mtime_nsec = st->st_mtim.tv_nsec;
+    memcpy(k->tool, tool, tool_length);
+    memcpy(k->options, options, options_length);
+    return 0;
+}
+
+static void unmap(void)
+{
+    if (cache_map != NULL)
+        munmap(cache_map, cache_size);
+    cache_map = NULL;
+    cache_size = 0;
+}
+
+static void cache_close(void)
+{
+    unmap();
+    if (cache_fd >= 0)
+        close(cache_fd);
+    cache_fd = -1;
+}
+
+/* Locks the cache file, reopening it if it has been replaced by another
+ * run in the meantime. Returns -1 if there is none and create is 0. */
+static int lock(int how, int create)
+{
+    struct stat a, b;
+
+    for (;;) {
+        if (cache_fd < 0) {
+            if (cache_path() == NULL)
+                return -1;
+            if ((cache_fd = open(cache_name, create ? O_RDWR | O_CREAT : O_RDWR, 0644)) < 0)
+                return -1;
+        }
+        while (flock(cache_fd, how) != 0) {
+            if (errno != EINTR) {
+                cache_close();
+                return -1;
+            }
+        }
+        if (stat(cache_name, &a) == 0 && fstat(cache_fd, &b) == 0
+            && a.st_dev == b.st_dev && a.st_ino == b.st_ino)
+            return 0;
+        cache_close();
+    }
+}
+
+static void unlock(void)
+{
+    if (cache_fd >= 0)
+        flock(cache_fd, LOCK_UN);
+}
+
+/* Maps the file as it is now and checks the header. Returns the header
+ * or NULL if the file is empty or damaged. */
+static const struct cache_header *map_file(void)
+{
+    const struct cache_header *h;
+    struct stat st;
+
+    if (fstat(cache_fd, &st) != 0)
+        return NULL;
+    if (cache_map == NULL || (size_t) st.st_size != cache_size) {
+        unmap();
+        if (st.st_size < (off_t) sizeof(*h))
+            return NULL;
+        cache_map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, cache_fd, 0);
+        if (cache_map == MAP_FAILED) {
+            cache_map = NULL;
+            return NULL;
+        }
+        cache_size = st.st_size;
+    }
+    h = (const struct cache_header *) cache_map;
+    if (memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0
+        || h->version != CACHE_VERSION || h->checksum != header_checksum(h)
+        || h->slots == 0 || (h->slots & (h->slots - 1)) != 0
+        || h->slots > (cache_size - sizeof(*h)) / sizeof(struct cache_slot)
+        || h->end < records_start(h->slots) || h->end > cache_size)
+        return NULL;
+    return h;
+}
+
+static const struct cache_slot *slots(const struct cache_header *h)
+{
+    return (const struct cache_slot *) (h + 1);
+}
+
+/* The record at offset, if it is complete and intact. */
+static const struct cache_record *record_at(const struct cache_header *h, uint64_t offset)
+{
+    const struct cache_record *r;
+
+    if (offset < records_start(h->slots) || offset % 8 != 0
+        || offset + sizeof(*r) > h->end)
+        return NULL;
+    r = (const struct cache_record *) (cache_map + offset);
+    if (offset + record_size(r) > h->end || r->checksum != record_checksum(r))
+        return NULL;
+    return r;
+}
+
+/* Index of the slot of key k, or of the empty slot where it belongs;
+   h->slots if there is neither, in a damaged table without empty slot. */
+static uint64_t find(const struct cache_header *h, const struct cache_key *k, uint64_t hash)
+{
+    const struct cache_slot *s = slots(h);
+    uint64_t mask = h->slots - 1, i, probes;
+
+    for (i = hash & mask, probes = 0; s[i].offset != 0; i = (i + 1) & mask) {
+        const struct cache_record *r;
+        if (s[i].hash == hash && (r = record_at(h, s[i].offset)) != NULL
+            && memcmp(&r->key, k, sizeof(*k)) == 0)
+            break;
+        if (++probes == h->slots)
+            return h->slots;
+    }
+    return i;
+}
+
+static int write_all(int fd, const void *p, size_t n, off_t offset)
+{
+    while (n > 0) {
+        ssize_t k = pwrite(fd, p, n, offset);
+        if (k < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p = (const char *) p + k;
+        n -= k;
+        offset += k;
+    }
+    return 0;
+}
+
+static int write_header(int fd, struct cache_header *h)
+{
+    h->checksum = header_checksum(h);
+    return write_all(fd, h, sizeof(*h), 0);
+}
+
+/* Puts an empty table of the given size into fd. */
+static int init_file(int fd, uint64_t n)
+{
+    struct cache_header h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+    h.version = CACHE_VERSION;
+    h.slots = n;
+    h.end = records_start(n);
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, h.end) != 0)
+        return -1;
+    return write_header(fd, &h);
+}
+
+/* The file of a record is still the same. */
+static int record_current(const struct cache_record *r)
+{
+    struct stat st;
+    struct cache_key k;
+
+    if (stat((const char *) (r + 1), &st) != 0
+        || make_key(&k, &st, r->key.tool, r->key.options) != 0)
+        return 0;
+    return k.dev == r->key.dev && k.ino == r->key.ino && k.size == r->key.size
+           && k.mtime_sec == r->key.mtime_sec && k.mtime_nsec == r->key.mtime_nsec;
+}
+
+/* Writes the records the slots point to into a new file with n slots,
+ * more if they would fill more than half of them, with check only those
+ * of files which have not changed, and puts it in place of the old one.
+ * The slots are counted, used in the header may be wrong. The new file
+ * is locked before it is renamed, so the caller keeps the exclusive
+ * lock. */
+static int rebuild(const struct cache_header *h, uint64_t n, int check,
+                   unsigned long *kept, unsigned long *dropped)
+{
+    const struct cache_slot *s = slots(h);
+    struct cache_slot *t;
+    struct cache_header nh;
+    char *tmpname;
+    uint64_t i, j, end;
+    int fd, ok;
+
+    *kept = *dropped = 0;
+    for (i = 0, j = 0; i < h->slots; ++i)
+        if (s[i].offset != 0)
+            ++j;
+    while (j * 2 > n)
+        n *= 2;
+    if ((tmpname = malloc(strlen(cache_name) + 32)) == NULL)
+        return -1;
+    sprintf(tmpname, "%s.%ld.tmp", cache_name, (long) getpid());
+    if ((fd = open(tmpname, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+        free(tmpname);
+        return -1;
+    }
+    if ((t = calloc(n, sizeof(*t))) == NULL) {
+        close(fd);
+        remove(tmpname);
+        free(tmpname);
+        return -1;
+    }
+    flock(fd, LOCK_EX);
+    ok = 1;
+    end = records_start(n);
+    for (i = 0; ok && i < h->slots; ++i) {
+        const struct cache_record *r;
+        if (s[i].offset == 0)
+            continue;
+        if ((r = record_at(h, s[i].offset)) == NULL || (check && !record_current(r))) {
+            ++*dropped;
+            continue;
+        }
+        for (j = s[i].hash & (n - 1); t[j].offset != 0; j = (j + 1) & (n - 1))
+            ;
+        t[j].hash = s[i].hash;
+        t[j].offset = end;
+        ok = write_all(fd, r, record_size(r), end) == 0;
+        end += record_size(r);
+        ++*kept;
+    }
+    memset(&nh, 0, sizeof(nh));
+    memcpy(nh.magic, CACHE_MAGIC, sizeof(nh.magic));
+    nh.version = CACHE_VERSION;
+    nh.slots = n;
+    nh.used = *kept;
+    nh.end = end;
+    ok = ok && ftruncate(fd, end) == 0
+         && write_all(fd, t, n * sizeof(*t), sizeof(nh)) == 0
+         && write_header(fd, &nh) == 0;
+    free(t);
+    if (!ok || rename(tmpname, cache_name) != 0) {
+        close(fd);
+        remove(tmpname);
+        free(tmpname);
+        return -1;
+    }
+    free(tmpname);
+    cache_close();
+    cache_fd = fd;
+    return 0;
+}
+
+void *cache_get(const struct stat *st, const char *tool, const char *options, size_t *size)
+{
+    const struct cache_header *h;
+    const struct cache_record *r;
+    struct cache_key k;
+    uint64_t hash, i;
+    void *data = NULL;
+
+    if (make_key(&k, st, tool, options) != 0 || lock(LOCK_SH, 0) != 0)
+        return NULL;
+    hash = checksum(0, &k, sizeof(k));
+    if ((h = map_file()) != NULL) {
+        i = find(h, &k, hash);
+        if (i < h->slots && slots(h)[i].offset != 0 && (r = record_at(h, slots(h)[i].offset)) != NULL
+            && (data = malloc(r->data_length ? r->data_length : 1)) != NULL) {
+            memcpy(data, (const char *) (r + 1) + padded(r->path_length + 1), r->data_length);
+            *size = r->data_length;
+        }
+    }
+    unlock();
+    return data;
+}
+
+void cache_put(const char *fname, const struct stat *st, const char *tool,
+               const char *options, const void *data, size_t size)
+{
+    const struct cache_header *h;
+    struct cache_header nh;
+    struct cache_record *r;
+    struct cache_slot slot;
+    struct stat now;
+    unsigned long kept, dropped;
+    char *path;
+    size_t path_length, n;
+    uint64_t hash, i;
+
+    if (stat(fname, &now) != 0 || now.st_dev != st->st_dev || now.st_ino != st->st_ino
+        || now.st_size != st->st_size || now.st_mtim.tv_sec != st->st_mtim.tv_sec
+        || now.st_mtim.tv_nsec != st->st_mtim.tv_nsec || size > UINT32_MAX)
+        return;
+    if ((path = realpath(fname, NULL)) == NULL)
+        return;
+    path_length = strlen(path);
+    n = sizeof(*r) + padded(path_length + 1) + padded(size);
+    if ((r = calloc(1, n)) == NULL) {
+        free(path);
+        return;
+    }
+    if (make_key(&r->key, st, tool, options) != 0) {
+        free(path);
+        free(r);
+        return;
+    }
+    r->path_length = path_length;
+    r->data_length = size;
+    memcpy(r + 1, path, path_length);
+    memcpy((char *) (r + 1) + padded(path_length + 1), data, size);
+    r->checksum = record_checksum(r);
+    hash = checksum(0, &r->key, sizeof(r->key));
+    free(path);
+
+    if (lock(LOCK_EX, 1) != 0) {
+        free(r);
+        return;
+    }
+    if ((h = map_file()) == NULL) {
+        if (init_file(cache_fd, CACHE_SLOTS) != 0 || (h = map_file()) == NULL)
+            goto done;
+    }
+    if ((h->used + 1) * 4 > h->slots * 3) {
+        if (rebuild(h, h->slots * 2, 0, &kept, &dropped) != 0 || (h = map_file()) == NULL)
+            goto done;
+    }
+    if ((i = find(h, &r->key, hash)) == h->slots) {
+        /* no empty slot, the count of used ones was wrong */
+        if (rebuild(h, h->slots * 2, 0, &kept, &dropped) != 0 || (h = map_file()) == NULL
+            || (i = find(h, &r->key, hash)) == h->slots)
+            goto done;
+    }
+    nh = *h;
+    if (slots(h)[i].offset == 0)
+        ++nh.used;
+    slot.hash = hash;
+    slot.offset = nh.end;
+    nh.end += n;
+    if (write_all(cache_fd, r, n, slot.offset) == 0 && write_header(cache_fd, &nh) == 0)
+        write_all(cache_fd, &slot, sizeof(slot), sizeof(nh) + i * sizeof(slot));
+done:
+    unlock();
+    free(r);
+}
+
+static int by_offset(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static int cache_list(void)
+{
+    const struct cache_header *h;
+    uint64_t *offsets, i, n = 0, bytes = 0;
+
+    if (lock(LOCK_SH, 0) != 0) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "%s: can't open %s (%s)\n", cache_progname,
+                    cache_path() ? cache_path() : "the cache", strerror(errno));
+            return EXIT_FAILURE;
+        }
+        printf("0 entries\n");
+        return EXIT_SUCCESS;
+    }
+    if ((h = map_file()) == NULL) {
+        unlock();
+        fprintf(stderr, "%s: %s is damaged, --cache=purge removes it\n",
+                cache_progname, cache_name);
+        return EXIT_FAILURE;
+    }
+    if ((offsets = malloc((h->used + 1) * sizeof(*offsets))) == NULL) {
+        unlock();
+        fprintf(stderr, "%s: out of memory\n", cache_progname);
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < h->slots && n <= h->used; ++i) {
+        if (slots(h)[i].offset != 0)
+            offsets[n++] = slots(h)[i].offset;
+    }
+    qsort(offsets, n, sizeof(*offsets), by_offset);
+    for (i = 0; i < n; ++i) {
+        const struct cache_record *r = record_at(h, offsets[i]);
+        char mtime[32];
+        time_t t;
+        if (r == NULL)
+            continue;
+        t = r->key.mtime_sec;
+        strftime(mtime, sizeof(mtime), "%Y-%m-%d %H:%M:%S", localtime(&t));
+        printf("%-14s %-8s %12llu  %s  %s\n", r->key.tool,
+               r->key.options[0] ? r->key.options : "-",
+               (unsigned long long) r->key.size, mtime, (const char *) (r + 1));
+        bytes += record_size(r);
+    }
+    printf("%llu entries, %llu bytes, %llu bytes of replaced entries\n",
+           (unsigned long long) n, (unsigned long long) cache_size,
+           (unsigned long long) (h->end - records_start(h->slots) - bytes));
+    free(offsets);
+    unlock();
+    return EXIT_SUCCESS;
+}
+
+static int cache_compact(void)
+{
+    const struct cache_header *h;
+    unsigned long kept, dropped;
+    uint64_t n = CACHE_SLOTS;
+
+    if (lock(LOCK_EX, 0) != 0) {
+        if (errno == ENOENT)
+            return EXIT_SUCCESS;
+        fprintf(stderr, "%s: can't open %s (%s)\n", cache_progname,
+                cache_path() ? cache_path() : "the cache", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((h = map_file()) == NULL) {
+        unlock();
+        fprintf(stderr, "%s: %s is damaged, --cache=purge removes it\n",
+                cache_progname, cache_name);
+        return EXIT_FAILURE;
+    }
+    while (h->used * 2 > n)
+        n *= 2;
+    if (rebuild(h, n, 1, &kept, &dropped) != 0) {
+        unlock();
+        fprintf(stderr, "%s: can't rewrite %s (%s)\n", cache_progname, cache_name,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+    unlock();
+    printf("%lu entries kept, %lu dropped\n", kept, dropped);
+    return EXIT_SUCCESS;
+}
+
+static int cache_purge(void)
+{
+    if (lock(LOCK_EX, 0) != 0) {
+        if (errno == ENOENT)
+            return EXIT_SUCCESS;
+    } else if (unlink(cache_name) == 0) {
+        cache_close();
+        return EXIT_SUCCESS;
+    }
+    fprintf(stderr, "%s: can't remove %s (%s)\n", cache_progname,
+            cache_path() ? cache_path() : "the cache", strerror(errno));
+    return EXIT_FAILURE;
+}
+
+int cache_option(const char *arg, const char *progname)
+{
+    if (strncmp(arg, "--cache", 7) != 0 || (arg[7] != '\0' && arg[7] != '='))
+        return 0;
+    cache_progname = progname;
+    if (arg[7] == '\0') {
+        cache_enabled = 1;
+        return 1;
+    }
+    arg += 8;
+    if (strcmp(arg, "list") == 0)
+        exit(cache_list());
+    if (strcmp(arg, "compact") == 0)
+        exit(cache_compact());
+    if (strcmp(arg, "purge") == 0)
+        exit(cache_purge());
+    fprintf(stderr, "%s: unknown cache command %s, use list, compact or purge\n",
+            progname, arg);
+    exit(EXIT_FAILURE);
+}
+
+#else
+
+void *cache_get(const struct stat *st, const char *tool, const char *options, size_t *size)
+{
+    return NULL;
+}
+
+void cache_put(const char *fname, const struct stat *st, const char *tool,
+               const char *options, const void *data, size_t size)
+{
+}
+
+int cache_option(const char *arg, const char *progname)
+{
+    if (strncmp(arg, "--cache", 7) != 0 || (arg[7] != '\0' && arg[7] != '='))
+        return 0;
+    fprintf(stderr, "%s: the result cache is not supported here\n", progname);
+    if (arg[7] == '=')
+        exit(EXIT_FAILURE);
+    return 1;
+}
+
+#endif
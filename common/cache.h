@@ -0,0 +1,43 @@
+/* File: cache.h */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Results of charstat and linelengths kept on disk, so that unchanged
+ * files need not be read again. An entry is found by device, inode,
+ * size and modification time of the file, the name and version of the
+ * tool and its options; a changed file simply gets a new entry.
+ *
+ * The cache is a single file, $RESULT_CACHE or toolresults below
+ * $XDG_CACHE_HOME (or ~/.cache): a hash table of fixed size followed by
+ * the records, which are only ever appended. Concurrent runs lock it
+ * with flock(), shared for lookups and exclusive for changes. When the
+ * table fills up, or with --cache=compact, the file is written anew
+ * under a temporary name and renamed, without the records which were
+ * replaced; compaction also drops those whose file has changed or is
+ * gone. A cache which can't be used only costs the time of reading. */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* Set by --cache. */
+extern int cache_enabled;
+
+/* Returns 1 if arg is one of the --cache options, which is carried out:
+ * --cache enables the cache, --cache=list, --cache=compact and
+ * --cache=purge print or change it and exit. */
+int cache_option(const char *arg, const char *progname);
+
+/* The result stored for the file with status st, in memory allocated
+ * with malloc(), or NULL. *size gets its length. */
+void *cache_get(const struct stat *st, const char *tool, const char *options, size_t *size);
+
+/* Stores the result for the file fname, which had the status st before
+ * it was read. Nothing is stored if the file has changed since. */
+void cache_put(const char *fname, const struct stat *st, const char *tool,
+               const char *options, const void *data, size_t size);
+
+#endif
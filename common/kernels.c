@@ -0,0 +1,415 @@
+/* File: kernels.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* See kernels.h. The vector versions are compiled with target
+ * attributes, the rest of the program with the flags of the Makefile.
+ * The table starts with functions which choose the level at their
+ * first call, for a single thread; the tools call kernels_level() in
+ * main() instead, before any thread can use the table. The histogram can't be vectorized without a scatter-add;
+ * above the scalar level it counts into four tables, which avoids the
+ * stalls of repeated bytes incrementing the same counter. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#define HIST_CHUNK (1UL << 30)  /* keeps the 32 bit counters from overflowing */
+
+static const char *const level_names[] = {"scalar", "sse2", "avx2", "avx512"};
+static int level = -1;
+
+/* ---- scalar ---- */
+
+static const unsigned char *find_eol_scalar(const unsigned char *p, const unsigned char *end)
+{
+    while (p < end && *p != '\n' && *p != '\r')
+        ++p;
+    return p;
+}
+
+static const unsigned char *find_byte_scalar(const unsigned char *p, const unsigned char *end, int c)
+{
+    const unsigned char *q = p < end ? memchr(p, c, end - p) : NULL;
+    return q ? q : end;
+}
+
+static void histogram_scalar(const unsigned char *p, size_t n, unsigned long count[256])
+{
+    while (n-- > 0)
+        ++count[*p++];
+}
+
+static void histogram_tables(const unsigned char *p, size_t n, unsigned long count[256])
+{
+    uint32_t t[4][256];
+    size_t i, k;
+    int c;
+
+    while (n > 0) {
+        k = n < HIST_CHUNK ? n : HIST_CHUNK;
+        memset(t, 0, sizeof(t));
+        for (i = 0; i + 4 <= k; i += 4) {
+            ++t[0][p[i]];
+            ++t[1][p[i+1]];
+            ++t[2][p[i+2]];
+            ++t[3][p[i+3]];
+        }
+        for (; i < k; ++i)
+            ++t[0][p[i]];
+        for (c = 0; c < 256; ++c)
+            count[c] += (unsigned long) t[0][c] + t[1][c] + t[2][c] + t[3][c];
+        p += k;
+        n -= k;
+    }
+}
+
+static void hex_line_scalar(const unsigned char *in, unsigned char *hex, unsigned char *asc,
+                            const unsigned char digits[16], int replacement, int eightbit)
+{
+    int i;
+
+    for (i = 0; i < 16; ++i) {
+        unsigned char b = in[i];
+        hex[0] = digits[b >> 4];
+        hex[1] = digits[b & 0xf];
+        hex[2] = ' ';
+        if (i == 7) {
+            hex[3] = ' ';
+            ++hex;
+        }
+        hex += 3;
+        asc[i] = b >= 32 && b < 127 || eightbit && b >= 128 ? b : replacement;
+    }
+}
+
+/* ---- x86 ---- */
+
+#ifdef KERNELS_X86
+__attribute__((target("sse2")))
+static const unsigned char *find_eol_sse2(const unsigned char *p, const unsigned char *end)
+{
+    const __m128i nl = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) p);
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr)));
+        if (m)
+            return p + __builtin_ctz(m);
+    }
+    return find_eol_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static const unsigned char *find_byte_sse2(const unsigned char *p, const unsigned char *end, int c)
+{
+    const __m128i b = _mm_set1_epi8((char) c);
+
+    for (; end - p >= 16; p += 16) {
+        int m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) p), b));
+        if (m)
+            return p + __builtin_ctz(m);
+    }
+    while (p < end && *p != (unsigned char) c)
+        ++p;
+    return p;
+}
+
+/* The digits come from a table lookup with pshufb, are interleaved and
+   spread to groups of three with blanks. */
+__attribute__((target("ssse3")))
+static void hex_line_ssse3(const unsigned char *in, unsigned char *hex, unsigned char *asc,
+                           const unsigned char digits[16], int replacement, int eightbit)
+{
+    const __m128i spread0 = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+    const __m128i spread1 = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i blanks0 = _mm_setr_epi8(0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0);
+    const __m128i blanks1 = _mm_setr_epi8(0, 32, 0, 0, 32, 0, 0, 32, 32, 32, 32, 32, 32, 32, 32, 32);
+    const __m128i table = _mm_loadu_si128((const __m128i *) digits);
+    const __m128i low = _mm_set1_epi8(0x0f);
+    const __m128i v = _mm_loadu_si128((const __m128i *) in);
+    __m128i hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+    __m128i lo = _mm_shuffle_epi8(table, _mm_and_si128(v, low));
+    __m128i a = _mm_unpacklo_epi8(hi, lo), b = _mm_unpackhi_epi8(hi, lo);
+    __m128i printable;
+
+    _mm_storeu_si128((__m128i *) hex, _mm_or_si128(_mm_shuffle_epi8(a, spread0), blanks0));
+    _mm_storel_epi64((__m128i *) (hex + 16), _mm_or_si128(_mm_shuffle_epi8(a, spread1), blanks1));
+    hex[24] = ' ';
+    _mm_storeu_si128((__m128i *) (hex + 25), _mm_or_si128(_mm_shuffle_epi8(b, spread0), blanks0));
+    _mm_storel_epi64((__m128i *) (hex + 41), _mm_or_si128(_mm_shuffle_epi8(b, spread1), blanks1));
+
+    printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(31)),
+                              _mm_cmplt_epi8(v, _mm_set1_epi8(127)));
+    if (eightbit)
+        printable = _mm_or_si128(printable, _mm_cmplt_epi8(v, _mm_setzero_si128()));
+    _mm_storeu_si128((__m128i *) asc,
+                     _mm_or_si128(_mm_and_si128(printable, v),
+                                  _mm_andnot_si128(printable, _mm_set1_epi8((char) replacement))));
+}
+
+__attribute__((target("avx2")))
+static const unsigned char *find_eol_avx2(const unsigned char *p, const unsigned char *end)
+{
+    const __m256i nl = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) p);
+        unsigned m = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, nl),
+                                                          _mm256_cmpeq_epi8(v, cr)));
+        if (m)
+            return p + __builtin_ctz(m);
+    }
+    return find_eol_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const unsigned char *find_byte_avx2(const unsigned char *p, const unsigned char *end, int c)
+{
+    const __m256i b = _mm256_set1_epi8((char) c);
+
+    for (; end - p >= 32; p += 32) {
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) p), b));
+        if (m)
+            return p + __builtin_ctz(m);
+    }
+    return find_byte_sse2(p, end, c);
+}
+
+/* The rest of the input is read with a masked load, which doesn't
+   fault on the bytes left out. */
+__attribute__((target("avx512f,avx512bw,bmi2")))
+static const unsigned char *find_eol_avx512(const unsigned char *p, const unsigned char *end)
+{
+    const __m512i nl = _mm512_set1_epi8('\n'), cr = _mm512_set1_epi8('\r');
+    __m512i v;
+    uint64_t m;
+
+    for (; end - p >= 64; p += 64) {
+        v = _mm512_loadu_si512(p);
+        m = _mm512_cmpeq_epi8_mask(v, nl) | _mm512_cmpeq_epi8_mask(v, cr);
+        if (m)
+            return p + __builtin_ctzll(m);
+    }
+    if (p < end) {
+        __mmask64 rest = _bzhi_u64(~0ULL, end - p);
+        v = _mm512_maskz_loadu_epi8(rest, p);
+        m = (_mm512_cmpeq_epi8_mask(v, nl) | _mm512_cmpeq_epi8_mask(v, cr)) & rest;
+        if (m)
+            return p + __builtin_ctzll(m);
+    }
+    return end;
+}
+
+__attribute__((target("avx512f,avx512bw,bmi2")))
+static const unsigned char *find_byte_avx512(const unsigned char *p, const unsigned char *end, int c)
+{
+    const __m512i b = _mm512_set1_epi8((char) c);
+    uint64_t m;
+
+    for (; end - p >= 64; p += 64) {
+        m = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), b);
+        if (m)
+            return p + __builtin_ctzll(m);
+    }
+    if (p < end) {
+        __mmask64 rest = _bzhi_u64(~0ULL, end - p);
+        m = _mm512_cmpeq_epi8_mask(_mm512_maskz_loadu_epi8(rest, p), b) & rest;
+        if (m)
+            return p + __builtin_ctzll(m);
+    }
+    return end;
+}
+#endif
+
+/* ---- selection ---- */
+
+static int supported_level(void)
+{
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("bmi2"))
+        return KERNEL_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return KERNEL_SSE2;
+#endif
+    return KERNEL_SCALAR;
+}
+
+static void select_level(int l)
+{
+    level = l;
+    kernels.find_eol = find_eol_scalar;
+    kernels.find_byte = find_byte_scalar;
+    kernels.histogram = histogram_scalar;
+    kernels.hex_line = hex_line_scalar;
+#ifdef KERNELS_X86
+    if (l >= KERNEL_SSE2) {
+        kernels.find_eol = find_eol_sse2;
+        kernels.find_byte = find_byte_sse2;
+        kernels.histogram = histogram_tables;
+        if (__builtin_cpu_supports("ssse3"))
+            kernels.hex_line = hex_line_ssse3;
+    }
+    if (l >= KERNEL_AVX2) {
+        kernels.find_eol = find_eol_avx2;
+        kernels.find_byte = find_byte_avx2;
+    }
+    if (l >= KERNEL_AVX512) {
+        kernels.find_eol = find_eol_avx512;
+        kernels.find_byte = find_byte_avx512;
+    }
+#endif
+}
+
+static const unsigned char *find_eol_first(const unsigned char *p, const unsigned char *end)
+{
+    select_level(supported_level());
+    return kernels.find_eol(p, end);
+}
+
+static const unsigned char *find_byte_first(const unsigned char *p, const unsigned char *end, int c)
+{
+    select_level(supported_level());
+    return kernels.find_byte(p, end, c);
+}
+
+static void histogram_first(const unsigned char *p, size_t n, unsigned long count[256])
+{
+    select_level(supported_level());
+    kernels.histogram(p, n, count);
+}
+
+static void hex_line_first(const unsigned char *in, unsigned char *hex, unsigned char *asc,
+                           const unsigned char digits[16], int replacement, int eightbit)
+{
+    select_level(supported_level());
+    kernels.hex_line(in, hex, asc, digits, replacement, eightbit);
+}
+
+struct kernels kernels = {find_eol_first, find_byte_first, histogram_first, hex_line_first};
+
+const char *kernels_level(void)
+{
+    if (level < 0)
+        select_level(supported_level());
+    return level_names[level];
+}
+
+/* ---- --cpu=check ---- */
+
+static uint32_t check_state = 1;
+
+static unsigned check_random(void)
+{
+    check_state = check_state * 1103515245 + 12345;
+    return check_state >> 16;
+}
+
+/* Compares the kernels of the level in use with plain loops, on all
+   alignments and lengths up to 200, the bytes from a small alphabet so
+   that there are many hits. Returns the number of differences. */
+static int check_level(const char *progname)
+{
+    static const unsigned char alphabet[] = {'a', '\n', '\r', 0, 0xff, ' ', 0x7f, 0x80};
+    static const unsigned char lc[16] = "0123456789abcdef", uc[16] = "0123456789ABCDEF";
+    unsigned char buf[512];
+    unsigned long count[256], expected[256];
+    size_t start, n, i;
+    int failed = 0, round;
+
+    for (round = 0; round < 4; ++round) {
+        for (i = 0; i < sizeof(buf); ++i)
+            buf[i] = round == 0 ? 'x' : alphabet[check_random() % (round * 2)];
+        for (start = 0; start < 64; ++start) {
+            for (n = 0; n <= 200; ++n) {
+                const unsigned char *p = buf + start, *end = p + n, *q;
+                int c = alphabet[check_random() % 8];
+                for (q = p; q < end && *q != '\n' && *q != '\r'; ++q)
+                    ;
+                if (kernels.find_eol(p, end) != q && failed++ < 5)
+                    fprintf(stderr, "%s: find_eol differs at %zu+%zu\n", progname, start, n);
+                for (q = p; q < end && *q != c; ++q)
+                    ;
+                if (kernels.find_byte(p, end, c) != q && failed++ < 5)
+                    fprintf(stderr, "%s: find_byte differs at %zu+%zu\n", progname, start, n);
+            }
+        }
+    }
+    for (round = 0; round < 200; ++round) {
+        start = check_random() % 64;
+        n = check_random() % (sizeof(buf) - 64);
+        for (i = 0; i < sizeof(buf); ++i)
+            buf[i] = check_random();
+        memset(count, 0, sizeof(count));
+        memset(expected, 0, sizeof(expected));
+        for (i = 0; i < n; ++i)
+            ++expected[buf[start + i]];
+        kernels.histogram(buf + start, n, count);
+        if (memcmp(count, expected, sizeof(count)) != 0 && failed++ < 5)
+            fprintf(stderr, "%s: histogram differs at %zu+%zu\n", progname, start, n);
+    }
+    for (round = 0; round < 4096; ++round) {
+        unsigned char hex[2][64], asc[2][16];
+        const unsigned char *digits = round & 1 ? uc : lc;
+        int eightbit = round >> 1 & 1, replacement = round & 4 ? '.' : 0xb7;
+        for (i = 0; i < 16; ++i)
+            buf[i] = round < 16 ? round * 16 + i : check_random();
+        memset(hex, 0, sizeof(hex));
+        hex_line_scalar(buf, hex[0], asc[0], digits, replacement, eightbit);
+        kernels.hex_line(buf, hex[1], asc[1], digits, replacement, eightbit);
+        if ((memcmp(hex[0], hex[1], 49) != 0 || memcmp(asc[0], asc[1], 16) != 0)
+            && failed++ < 5)
+            fprintf(stderr, "%s: hex_line differs in round %d\n", progname, round);
+    }
+    return failed;
+}
+
+int kernels_option(const char *arg, const char *progname)
+{
+    int best, l;
+
+    if (strncmp(arg, "--cpu=", 6) != 0)
+        return 0;
+    arg += 6;
+    best = supported_level();
+    if (strcmp(arg, "list") == 0) {
+        for (l = 0; l <= best; ++l)
+            printf("%s%s\n", level_names[l], l == best ? " (default)" : "");
+        exit(EXIT_SUCCESS);
+    }
+    if (strcmp(arg, "check") == 0) {
+        int failed = 0;
+        for (l = 0; l <= best; ++l) {
+            int f;
+            select_level(l);
+            f = check_level(progname);
+            printf("%-8s %s\n", level_names[l], f ? "FAILED" : "ok");
+            failed += f;
+        }
+        exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    for (l = 0; l <= KERNEL_AVX512 && strcmp(arg, level_names[l]) != 0; ++l)
+        ;
+    if (l > KERNEL_AVX512) {
+        fprintf(stderr, "%s: unknown CPU level %s (scalar, sse2, avx2, avx512)\n", progname, arg);
+        exit(EXIT_FAILURE);
+    }
+    if (l > best) {
+        fprintf(stderr, "%s: the CPU does not support %s\n", progname, arg);
+        exit(EXIT_FAILURE);
+    }
+    select_level(l);
+    return 1;
+}
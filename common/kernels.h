@@ -0,0 +1,51 @@
+/* File: kernels.h */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* The inner loops of hdump, charstat, linelengths, joinlines and
+ * contains. find_eol and find_byte have versions for SSE2, AVX2 and
+ * AVX-512 on x86, hex_line one for SSSE3 used from the SSE2 level up;
+ * the histogram stays scalar and counts into four tables above the
+ * scalar level. The best versions the CPU supports are chosen at the
+ * first call or by kernels_level(), the binaries need no -march and run
+ * everywhere. The choice rewrites the table, so programs with threads
+ * call kernels_level() before they start them. Option --cpu=level
+ * limits the level for comparisons, --cpu=list shows the levels,
+ * --cpu=check compares every version with the scalar one. */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+
+#define KERNEL_SCALAR 0
+#define KERNEL_SSE2   1
+#define KERNEL_AVX2   2
+#define KERNEL_AVX512 3
+
+struct kernels {
+    /* first '\n' or '\r' in [p, end), end if there is none */
+    const unsigned char *(*find_eol)(const unsigned char *p, const unsigned char *end);
+    /* first byte c in [p, end), end if there is none */
+    const unsigned char *(*find_byte)(const unsigned char *p, const unsigned char *end, int c);
+    /* adds the bytes of p to count */
+    void (*histogram)(const unsigned char *p, size_t n, unsigned long count[256]);
+    /* a line of 16 bytes in the form of hdump: hex gets 49 characters,
+       two digits from digits[] and a blank per byte and another blank
+       after the eighth byte; asc gets the bytes, those which are not
+       printable replaced */
+    void (*hex_line)(const unsigned char *in, unsigned char *hex, unsigned char *asc,
+                     const unsigned char digits[16], int replacement, int eightbit);
+};
+
+extern struct kernels kernels;
+
+/* Returns 1 if arg is one of the --cpu= options, which is carried out:
+ * --cpu=scalar, sse2, avx2 or avx512 selects the level, --cpu=list and
+ * --cpu=check print their results and exit. */
+int kernels_option(const char *arg, const char *progname);
+
+/* The level in use, chosen now if that hasn't happened yet. */
+const char *kernels_level(void);
+
+#endif
@@ -0,0 +1,910 @@
+/* File: reader.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* See reader.h. Without __unix__ the input is read with stdio, there is
+ * no mapping and no direct I/O then, and no decompression.
+ *
+ * The gzip thread inflates into a ring buffer, from which read_full()
+ * copies; the ring holds several blocks, so the thread can go on while
+ * the caller works on the last one. Members of concatenated files are
+ * decompressed one after the other like gzip -d does, anything else after
+ * the end of a member is ignored. A compressed file is rewound by
+ * starting again at its beginning.
+ *
+ * reader_gather() puts the ranges into one buffer, each at an aligned
+ * position. For a regular file the threads take the next range from a
+ * shared counter and pread() it; the caller is one of them. Other input
+ * is read in order with reader_seek(). */
+
+#define _GNU_SOURCE             /* O_DIRECT */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#endif
+
+#include "reader.h"
+#include "stats.h"
+
+#ifndef READER_BLOCK
+#define READER_BLOCK  1048576   /* read size, a multiple of READER_ALIGN */
+#endif
+
+#ifndef READER_WINDOW
+#define READER_WINDOW 16777216  /* block of a mapped file */
+#endif
+
+#define READER_ALIGN  4096      /* buffer alignment, as O_DIRECT needs it */
+
+#define READER_RING   (4 * READER_BLOCK)  /* decompressed data ahead */
+
+#ifndef READER_THREADS
+#define READER_THREADS 8        /* concurrent reads of reader_gather() */
+#endif
+
+const char *reader_progname = "reader";
+
+#if defined(__unix__) && defined(HAVE_ZLIB)
+const int reader_gunzip = 1;
+#else
+const int reader_gunzip = 0;
+#endif
+
+static void *reader_alloc(size_t size)
+{
+    void *p;
+#ifdef __unix__
+    if (posix_memalign(&p, READER_ALIGN, size) != 0)
+        p = NULL;
+#else
+    p = malloc(size);
+#endif
+    if (p == NULL) {
+        fprintf(stderr, "%s: out of memory\n", reader_progname);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void read_error(struct reader *r)
+{
+    fprintf(stderr, "%s: read error on %s (%s)\n", reader_progname, r->name, strerror(errno));
+    r->error = 1;
+}
+
+#ifdef __unix__
+static void end_direct(struct reader *r);
+
+#ifdef HAVE_ZLIB
+struct gunzip {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t more, space;
+    unsigned char *ring;
+    uint64_t head, tail;        /* bytes put into and taken from the ring */
+    int done, stop;
+    const char *problem;        /* why decompression ended early */
+    int fd;
+    off_t start;                /* of the compressed data */
+    unsigned char magic[2];     /* already read from a pipe */
+    size_t magic_length;
+    unsigned char *in;
+    char message[128];
+};
+
+static int is_gzip(const unsigned char *p)
+{
+    return p[0] == 0x1f && p[1] == 0x8b;
+}
+
+static void *gunzip_thread(void *arg)
+{
+    struct gunzip *g = arg;
+    z_stream z;
+    int status = Z_OK;
+
+    memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) {
+        g->problem = "can't initialize zlib";
+        goto done;
+    }
+    memcpy(g->in, g->magic, g->magic_length);
+    z.next_in = g->in;
+    z.avail_in = g->magic_length;
+    for (;;) {
+        size_t pos, span;
+        uInt before;
+        int stop;
+        if (z.avail_in == 0) {
+            ssize_t k;
+            while ((k = read(g->fd, g->in, READER_BLOCK)) < 0 && errno == EINTR)
+                ;
+            if (k < 0) {
+                snprintf(g->message, sizeof(g->message), "%s", strerror(errno));
+                g->problem = g->message;
+                break;
+            }
+            if (k == 0) {
+                if (status != Z_STREAM_END)
+                    g->problem = "unexpected end of compressed data";
+                break;
+            }
+            z.next_in = g->in;
+            z.avail_in = k;
+        }
+        if (status == Z_STREAM_END) {
+            if (z.next_in[0] != 0x1f)
+                break;
+            inflateReset(&z);
+        }
+
+        pthread_mutex_lock(&g->lock);
+        while (!g->stop && g->head - g->tail == READER_RING)
+            pthread_cond_wait(&g->space, &g->lock);
+        pos = g->head % READER_RING;
+        span = READER_RING - (g->head - g->tail);
+        if (span > READER_RING - pos)
+            span = READER_RING - pos;
+        stop = g->stop;
+        pthread_mutex_unlock(&g->lock);
+        if (stop)
+            break;
+
+        z.next_out = g->ring + pos;
+        z.avail_out = before = span;
+        status = inflate(&z, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            snprintf(g->message, sizeof(g->message), "%s",
+                     z.msg ? z.msg : "corrupt compressed data");
+            g->problem = g->message;
+            break;
+        }
+        if (before > z.avail_out) {
+            pthread_mutex_lock(&g->lock);
+            g->head += before - z.avail_out;
+            pthread_cond_signal(&g->more);
+            pthread_mutex_unlock(&g->lock);
+        }
+    }
+    inflateEnd(&z);
+done:
+    pthread_mutex_lock(&g->lock);
+    g->done = 1;
+    pthread_cond_signal(&g->more);
+    pthread_mutex_unlock(&g->lock);
+    return NULL;
+}
+
+static int gunzip_start(struct reader *r)
+{
+    struct gunzip *g = r->gz;
+    int e;
+
+    g->head = g->tail = 0;
+    g->done = g->stop = 0;
+    g->problem = NULL;
+    if ((e = pthread_create(&g->thread, NULL, gunzip_thread, g)) != 0) {
+        fprintf(stderr, "%s: can't start a thread for %s (%s)\n",
+                reader_progname, r->name, strerror(e));
+        r->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+static void gunzip_stop(struct reader *r)
+{
+    struct gunzip *g = r->gz;
+
+    pthread_mutex_lock(&g->lock);
+    g->stop = 1;
+    pthread_cond_signal(&g->space);
+    pthread_mutex_unlock(&g->lock);
+    pthread_join(g->thread, NULL);
+}
+
+/* Switches the reader to decompression. magic has the first bytes if
+   they have been read already. */
+static void gunzip_open(struct reader *r, const unsigned char *magic, size_t length)
+{
+    struct gunzip *g = calloc(1, sizeof(*g));
+
+    if (g == NULL || (g->ring = malloc(READER_RING)) == NULL
+        || (g->in = malloc(READER_BLOCK)) == NULL) {
+        fprintf(stderr, "%s: out of memory\n", reader_progname);
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->more, NULL);
+    pthread_cond_init(&g->space, NULL);
+    g->fd = r->fd;
+    g->start = r->start;
+    memcpy(g->magic, magic, length);
+    g->magic_length = length;
+    end_direct(r);
+    if (r->regular)
+        posix_fadvise(r->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    r->gz = g;
+    r->compressed = 1;
+    r->regular = 0;
+    r->size = 0;
+    r->start = r->offset = 0;
+    gunzip_start(r);
+}
+
+/* Takes up to n bytes out of the ring. */
+static size_t gunzip_read(struct reader *r, unsigned char *p, size_t n)
+{
+    struct gunzip *g = r->gz;
+    size_t done = 0;
+
+    while (done < n) {
+        size_t pos, span;
+        pthread_mutex_lock(&g->lock);
+        while (g->head == g->tail && !g->done)
+            pthread_cond_wait(&g->more, &g->lock);
+        pos = g->tail % READER_RING;
+        span = g->head - g->tail;
+        pthread_mutex_unlock(&g->lock);
+        if (span == 0) {
+            if (g->problem && !r->error) {
+                fprintf(stderr, "%s: can't decompress %s (%s)\n",
+                        reader_progname, r->name, g->problem);
+                r->error = 1;
+            }
+            break;
+        }
+        if (span > READER_RING - pos)
+            span = READER_RING - pos;
+        if (span > n - done)
+            span = n - done;
+        memcpy(p + done, g->ring + pos, span);
+        done += span;
+        pthread_mutex_lock(&g->lock);
+        g->tail += span;
+        pthread_cond_signal(&g->space);
+        pthread_mutex_unlock(&g->lock);
+    }
+    return done;
+}
+
+/* Starts the decompression again at the beginning of the file. */
+static int gunzip_rewind(struct reader *r)
+{
+    struct gunzip *g = r->gz;
+
+    gunzip_stop(r);
+    if (g->magic_length > 0 || lseek(r->fd, g->start, SEEK_SET) == (off_t) -1) {
+        fprintf(stderr, "%s: can't seek back in %s\n", reader_progname, r->name);
+        r->error = 1;
+        return -1;
+    }
+    r->offset = 0;
+    return gunzip_start(r);
+}
+
+static void gunzip_close(struct reader *r)
+{
+    struct gunzip *g = r->gz;
+
+    gunzip_stop(r);
+    pthread_mutex_destroy(&g->lock);
+    pthread_cond_destroy(&g->more);
+    pthread_cond_destroy(&g->space);
+    free(g->ring);
+    free(g->in);
+    free(g);
+    r->gz = NULL;
+}
+
+/* Looks at the first bytes: of a file without moving, of a pipe by
+   reading them, they are handed out first then. */
+static void gunzip_detect(struct reader *r)
+{
+    unsigned char *p;
+    ssize_t k = 0;
+
+    if (r->regular) {
+        if (r->size - r->start < 2)
+            return;
+        p = reader_alloc(READER_ALIGN);
+        if ((r->flags & READER_DIRECT) && r->start % READER_ALIGN == 0)
+            k = pread(r->fd, p, READER_ALIGN, r->start);
+        if (k < 2)
+            k = pread(r->fd, p, 2, r->start);
+        if (k >= 2 && is_gzip(p))
+            gunzip_open(r, p, 0);
+        free(p);
+        return;
+    }
+    while (r->peeked < 2) {
+        if ((k = read(r->fd, r->peek + r->peeked, 2 - r->peeked)) < 0 && errno == EINTR)
+            continue;
+        if (k < 0)
+            read_error(r);
+        if (k <= 0)
+            return;
+        r->peeked += k;
+    }
+    if (is_gzip(r->peek)) {
+        gunzip_open(r, r->peek, 2);
+        r->peeked = 0;
+    }
+}
+#endif
+
+static void setup(struct reader *r, int fd, const char *name, int flags, int own_fd)
+{
+    off_t pos;
+
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->flags = flags;
+    r->fd = fd;
+    r->own_fd = own_fd;
+    if (fstat(fd, &r->st) != 0 || !S_ISREG(r->st.st_mode)) {
+#ifdef HAVE_ZLIB
+        if (flags & READER_GUNZIP)
+            gunzip_detect(r);
+#endif
+        return;
+    }
+    r->regular = 1;
+    r->size = r->st.st_size;
+    if ((pos = lseek(fd, 0, SEEK_CUR)) > 0)
+        r->start = r->offset = pos;
+#ifdef HAVE_ZLIB
+    if (flags & READER_GUNZIP) {
+        gunzip_detect(r);
+        if (r->compressed)
+            return;
+    }
+#endif
+    if (r->size > 0 && !(flags & (READER_NOMAP | READER_DIRECT))) {
+        void *p = mmap(0, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            r->map = p;
+            madvise(p, r->size, MADV_SEQUENTIAL);
+            return;
+        }
+    }
+    if (!(flags & READER_DIRECT))
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+/* O_DIRECT needs aligned offsets, it is given up for others. */
+static void end_direct(struct reader *r)
+{
+#ifdef O_DIRECT
+    if (r->flags & READER_DIRECT) {
+        fcntl(r->fd, F_SETFL, fcntl(r->fd, F_GETFL) & ~O_DIRECT);
+        r->flags &= ~READER_DIRECT;
+        posix_fadvise(r->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+}
+
+/* read(), timed for --stats. */
+static ssize_t timed_read(int fd, void *p, size_t n)
+{
+    double t;
+    ssize_t k;
+
+    if (!stats_enabled)
+        return read(fd, p, n);
+    t = stats_clock();
+    k = read(fd, p, n);
+    stats_read(stats_clock() - t);
+    return k;
+}
+
+/* Reads until n bytes are there or the input ends. */
+static size_t read_full(struct reader *r, unsigned char *p, size_t n)
+{
+    size_t done = 0;
+
+    if (r->peeked > 0 && n > 0) {
+        done = r->peeked < n ? r->peeked : n;
+        memcpy(p, r->peek, done);
+        memmove(r->peek, r->peek + done, r->peeked - done);
+        r->peeked -= done;
+    }
+#ifdef HAVE_ZLIB
+    if (r->gz)
+        return done + gunzip_read(r, p + done, n - done);
+#endif
+    while (done < n) {
+        ssize_t k = timed_read(r->fd, p + done, n - done);
+        if (k < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EINVAL && (r->flags & READER_DIRECT)) {
+                end_direct(r);
+                continue;
+            }
+            read_error(r);
+            break;
+        }
+        if (k == 0)
+            break;
+        done += k;
+    }
+    return done;
+}
+
+int reader_open(struct reader *r, const char *fname, int flags)
+{
+    int fd = -1;
+
+#ifdef O_DIRECT
+    if (flags & READER_DIRECT)
+        fd = open(fname, O_RDONLY | O_DIRECT);
+#endif
+    if (fd < 0) {
+        flags &= ~READER_DIRECT;
+        fd = open(fname, O_RDONLY);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "%s: can't open %s (%s)\n", reader_progname, fname, strerror(errno));
+        memset(r, 0, sizeof(*r));
+        r->fd = -1;
+        r->error = 1;
+        return -1;
+    }
+    setup(r, fd, fname, flags, 1);
+    return 0;
+}
+
+void reader_stdin(struct reader *r, int flags)
+{
+    setup(r, STDIN_FILENO, "stdin", flags & ~READER_DIRECT, 0);
+}
+
+size_t reader_next(struct reader *r, const unsigned char **data)
+{
+    size_t n;
+
+    if (r->error)
+        return 0;
+    if (r->map) {
+        uint64_t end = r->offset + READER_WINDOW;
+        if (r->offset >= r->size)
+            return 0;
+        if (end >= r->size) {
+            end = r->size;
+        } else {
+            /* the next window is read ahead while this one is used */
+            uint64_t ahead = end - end % READER_ALIGN;
+            madvise(r->map + ahead, r->size - ahead < READER_WINDOW
+                                    ? r->size - ahead : READER_WINDOW, MADV_WILLNEED);
+        }
+        *data = r->map + r->offset;
+        n = end - r->offset;
+        r->offset = end;
+        if (stats_enabled)
+            stats_data(*data, n);
+        return n;
+    }
+    if (r->buffer == NULL)
+        r->buffer = reader_alloc(READER_BLOCK);
+    n = read_full(r, r->buffer, READER_BLOCK);
+    r->offset += n;
+    if (r->regular && n == READER_BLOCK && !(r->flags & READER_DIRECT))
+        posix_fadvise(r->fd, r->offset, READER_BLOCK, POSIX_FADV_WILLNEED);
+    *data = r->buffer;
+    if (stats_enabled)
+        stats_data(r->buffer, n);
+    return n;
+}
+
+int reader_seek(struct reader *r, uint64_t offset)
+{
+    if (r->error)
+        return -1;
+    if (r->map) {
+        r->offset = offset;
+        return 0;
+    }
+    if (r->regular) {
+        if (offset % READER_ALIGN != 0)
+            end_direct(r);
+        if (lseek(r->fd, offset, SEEK_SET) == (off_t) -1) {
+            fprintf(stderr, "%s: can't seek in %s (%s)\n",
+                    reader_progname, r->name, strerror(errno));
+            r->error = 1;
+            return -1;
+        }
+        r->offset = offset;
+        return 0;
+    }
+#ifdef HAVE_ZLIB
+    if (r->gz && offset < r->offset && gunzip_rewind(r) != 0)
+        return -1;
+#endif
+    if (offset < r->offset) {
+        fprintf(stderr, "%s: can't seek back in %s\n", reader_progname, r->name);
+        r->error = 1;
+        return -1;
+    }
+    if (r->buffer == NULL)
+        r->buffer = reader_alloc(READER_BLOCK);
+    while (r->offset < offset) {
+        uint64_t left = offset - r->offset;
+        size_t n = read_full(r, r->buffer, left < READER_BLOCK ? left : READER_BLOCK);
+        if (n == 0)
+            break;
+        r->offset += n;
+    }
+    return r->error ? -1 : 0;
+}
+
+int reader_rewind(struct reader *r)
+{
+    return reader_seek(r, r->start);
+}
+
+const unsigned char *reader_all(struct reader *r, size_t *size)
+{
+    size_t used = 0, max;
+
+    *size = 0;
+    if (r->error)
+        return NULL;
+    if (r->map || r->regular && r->offset >= r->size) {
+        const unsigned char *p = r->map ? r->map + r->offset : (const unsigned char *) "";
+        if (r->offset < r->size)
+            *size = r->size - r->offset;
+        r->offset += *size;
+        if (stats_enabled)
+            stats_data(p, *size);
+        return p;
+    }
+    end_direct(r);
+    free(r->all);
+    max = r->regular ? r->size - r->offset + 1 : READER_BLOCK;
+    r->all = reader_alloc(max);
+    for (;;) {
+        size_t n = read_full(r, r->all + used, max - used);
+        used += n;
+        if (r->error)
+            return NULL;
+        if (used < max)
+            break;
+        {
+            unsigned char *p = reader_alloc(2 * max);
+            memcpy(p, r->all, used);
+            free(r->all);
+            r->all = p;
+            max *= 2;
+        }
+    }
+    r->offset += used;
+    *size = used;
+    if (stats_enabled)
+        stats_data(r->all, used);
+    return r->all;
+}
+
+void reader_close(struct reader *r)
+{
+#ifdef HAVE_ZLIB
+    if (r->gz)
+        gunzip_close(r);
+#endif
+    if (r->map)
+        munmap(r->map, r->size);
+    if (r->own_fd && r->fd >= 0)
+        close(r->fd);
+    free(r->buffer);
+    free(r->all);
+    free(r->gathered);
+    r->map = r->buffer = r->all = r->gathered = NULL;
+    r->fd = -1;
+}
+
+struct gather {
+    int fd;
+    int direct;
+    uint64_t size;
+    struct reader_range *ranges;
+    double *seconds;            /* per range, for --stats */
+    size_t n, next;
+    int error;                  /* errno of the first failed read */
+    pthread_mutex_t lock;
+};
+
+static void gather_range(struct gather *g, struct reader_range *p, double *seconds)
+{
+    size_t want, done = 0;
+    double t = seconds ? stats_clock() : 0;
+
+    want = p->offset >= g->size ? 0 : g->size - p->offset < p->length
+                                      ? g->size - p->offset : p->length;
+    if (g->direct)              /* the slot is large enough */
+        want = (want + READER_ALIGN - 1) / READER_ALIGN * READER_ALIGN;
+    while (done < want) {
+        ssize_t k = pread(g->fd, (unsigned char *) p->data + done, want - done,
+                          p->offset + done);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k < 0) {
+            pthread_mutex_lock(&g->lock);
+            if (g->error == 0)
+                g->error = errno;
+            pthread_mutex_unlock(&g->lock);
+            break;
+        }
+        if (k == 0)
+            break;
+        done += k;
+    }
+    p->got = done < p->length ? done : p->length;
+    if (seconds)
+        *seconds = stats_clock() - t;
+}
+
+static void *gather_thread(void *arg)
+{
+    struct gather *g = arg;
+
+    for (;;) {
+        size_t i;
+        pthread_mutex_lock(&g->lock);
+        i = g->next++;
+        pthread_mutex_unlock(&g->lock);
+        if (i >= g->n)
+            break;
+        gather_range(g, &g->ranges[i], g->seconds ? &g->seconds[i] : NULL);
+    }
+    return NULL;
+}
+
+/* The ranges of a regular file, read concurrently. */
+static int gather_threads(struct reader *r, struct reader_range *ranges, size_t n)
+{
+    struct gather g;
+    pthread_t thread[READER_THREADS - 1];
+    size_t i, threads = 0;
+
+    for (i = 0; i < n; ++i)
+        if (ranges[i].offset % READER_ALIGN != 0)
+            end_direct(r);
+    memset(&g, 0, sizeof(g));
+    g.fd = r->fd;
+    g.direct = (r->flags & READER_DIRECT) != 0;
+    g.size = r->size;
+    g.ranges = ranges;
+    g.n = n;
+    if (stats_enabled && (g.seconds = calloc(n, sizeof(double))) == NULL) {
+        fprintf(stderr, "%s: out of memory\n", reader_progname);
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&g.lock, NULL);
+    if (!g.direct)
+        for (i = 0; i < n; ++i)
+            posix_fadvise(r->fd, ranges[i].offset, ranges[i].length, POSIX_FADV_WILLNEED);
+    /* the caller reads too, a thread which can't be started is missed */
+    while (threads < READER_THREADS - 1 && threads + 1 < n
+           && pthread_create(&thread[threads], NULL, gather_thread, &g) == 0)
+        ++threads;
+    gather_thread(&g);
+    for (i = 0; i < threads; ++i)
+        pthread_join(thread[i], NULL);
+    pthread_mutex_destroy(&g.lock);
+    if (g.seconds) {
+        for (i = 0; i < n; ++i)
+            stats_read(g.seconds[i]);
+        free(g.seconds);
+    }
+    if (g.error) {
+        errno = g.error;
+        read_error(r);
+        return -1;
+    }
+    return 0;
+}
+
+#else
+
+static void setup(struct reader *r, FILE *f, const char *name, int flags)
+{
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->flags = flags & ~READER_DIRECT;
+    r->f = f;
+    if (f != NULL && fstat(fileno(f), &r->st) == 0 && S_ISREG(r->st.st_mode)) {
+        r->regular = 1;
+        r->size = r->st.st_size;
+    }
+}
+
+static size_t read_full(struct reader *r, unsigned char *p, size_t n)
+{
+    double t = stats_enabled ? stats_clock() : 0;
+    size_t done = fread(p, 1, n, r->f);
+    if (stats_enabled)
+        stats_read(stats_clock() - t);
+    if (done < n && ferror(r->f))
+        read_error(r);
+    return done;
+}
+
+int reader_open(struct reader *r, const char *fname, int flags)
+{
+    FILE *f = fopen(fname, "rb");
+
+    if (f == NULL) {
+        fprintf(stderr, "%s: can't open %s (%s)\n", reader_progname, fname, strerror(errno));
+        setup(r, NULL, fname, flags);
+        r->error = 1;
+        return -1;
+    }
+    setup(r, f, fname, flags);
+    return 0;
+}
+
+void reader_stdin(struct reader *r, int flags)
+{
+    setup(r, stdin, "stdin", flags);
+}
+
+size_t reader_next(struct reader *r, const unsigned char **data)
+{
+    size_t n;
+
+    if (r->error)
+        return 0;
+    if (r->buffer == NULL)
+        r->buffer = reader_alloc(READER_BLOCK);
+    n = read_full(r, r->buffer, READER_BLOCK);
+    r->offset += n;
+    *data = r->buffer;
+    if (stats_enabled)
+        stats_data(r->buffer, n);
+    return n;
+}
+
+int reader_seek(struct reader *r, uint64_t offset)
+{
+    if (r->error)
+        return -1;
+    if (fseek(r->f, (long) offset, SEEK_SET) == 0) {
+        r->offset = offset;
+        return 0;
+    }
+    if (offset < r->offset) {
+        fprintf(stderr, "%s: can't seek in %s (%s)\n", reader_progname, r->name, strerror(errno));
+        r->error = 1;
+        return -1;
+    }
+    if (r->buffer == NULL)
+        r->buffer = reader_alloc(READER_BLOCK);
+    while (r->offset < offset) {
+        uint64_t left = offset - r->offset;
+        size_t n = read_full(r, r->buffer, left < READER_BLOCK ? left : READER_BLOCK);
+        if (n == 0)
+            break;
+        r->offset += n;
+    }
+    return r->error ? -1 : 0;
+}
+
+int reader_rewind(struct reader *r)
+{
+    return reader_seek(r, r->start);
+}
+
+const unsigned char *reader_all(struct reader *r, size_t *size)
+{
+    size_t used = 0, max = READER_BLOCK;
+
+    *size = 0;
+    if (r->error)
+        return NULL;
+    free(r->all);
+    r->all = reader_alloc(max);
+    for (;;) {
+        size_t n = read_full(r, r->all + used, max - used);
+        used += n;
+        if (r->error)
+            return NULL;
+        if (used < max)
+            break;
+        r->all = realloc(r->all, max *= 2);
+        if (r->all == NULL) {
+            fprintf(stderr, "%s: out of memory\n", reader_progname);
+            exit(EXIT_FAILURE);
+        }
+    }
+    r->offset += used;
+    *size = used;
+    if (stats_enabled)
+        stats_data(r->all, used);
+    return r->all;
+}
+
+void reader_close(struct reader *r)
+{
+    if (r->f != NULL && r->f != stdin)
+        fclose(r->f);
+    free(r->buffer);
+    free(r->all);
+    free(r->gathered);
+    r->buffer = r->all = r->gathered = NULL;
+    r->f = NULL;
+}
+
+#endif
+
+/* Places the ranges in gathered, each at an aligned position. */
+static void gather_buffer(struct reader *r, struct reader_range *ranges, size_t n)
+{
+    size_t i, total = 0;
+
+    for (i = 0; i < n; ++i)
+        total += (ranges[i].length + READER_ALIGN - 1) / READER_ALIGN * READER_ALIGN;
+    if (total > r->gathered_size || r->gathered == NULL) {
+        free(r->gathered);
+        r->gathered = reader_alloc(total > 0 ? total : READER_ALIGN);
+        r->gathered_size = total;
+    }
+    for (i = 0, total = 0; i < n; ++i) {
+        ranges[i].data = r->gathered + total;
+        ranges[i].got = 0;
+        total += (ranges[i].length + READER_ALIGN - 1) / READER_ALIGN * READER_ALIGN;
+    }
+}
+
+int reader_gather(struct reader *r, struct reader_range *ranges, size_t n)
+{
+    size_t i;
+
+    if (r->error)
+        return -1;
+#ifdef __unix__
+    if (r->map) {
+        for (i = 0; i < n; ++i) {
+            struct reader_range *p = &ranges[i];
+            p->data = r->map + (p->offset < r->size ? p->offset : r->size);
+            p->got = p->offset >= r->size ? 0 : r->size - p->offset < p->length
+                                                ? r->size - p->offset : p->length;
+            if (p->got > 0) {
+                uint64_t from = p->offset - p->offset % READER_ALIGN;
+                madvise(r->map + from, p->offset + p->got - from, MADV_WILLNEED);
+            }
+        }
+    } else
+#endif
+    {
+        gather_buffer(r, ranges, n);
+#ifdef __unix__
+        if (r->regular && gather_threads(r, ranges, n) != 0)
+            return -1;
+        if (!r->regular)
+#endif
+        for (i = 0; i < n; ++i) {
+            if (reader_seek(r, ranges[i].offset) != 0)
+                return -1;
+            ranges[i].got = read_full(r, (unsigned char *) ranges[i].data, ranges[i].length);
+            r->offset += ranges[i].got;
+            if (r->error)
+                return -1;
+        }
+    }
+    if (stats_enabled)
+        for (i = 0; i < n; ++i)
+            stats_data(ranges[i].data, ranges[i].got);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/* File: reader.h */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Input layer shared by hdump and the tools in Text. A regular file is
+ * mapped into memory and handed out in windows, other inputs are read
+ * into a large aligned buffer. Sequential access is announced to the
+ * kernel, and the next window or block is requested ahead of time.
+ * With READER_DIRECT the file is read with O_DIRECT, bypassing the page
+ * cache, for scans of data which is not read again soon. With
+ * READER_GUNZIP gzip data, recognized by its magic bytes, is decompressed
+ * by a thread running ahead of the caller, if the reader is compiled with
+ * HAVE_ZLIB; offsets are those of the decompressed data then.
+ *
+ * Errors are reported by the reader with the name of the file, the
+ * caller only has to count them: the functions return -1, 0 or NULL,
+ * and error is set. */
+
+#ifndef READER_H
+#define READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define READER_DIRECT 1         /* O_DIRECT for cold scans */
+#define READER_NOMAP  2         /* never map, needed if the file is
+                                   overwritten while its data is used */
+#define READER_GUNZIP 4         /* decompress gzip input */
+
+struct gunzip;
+
+struct reader {
+    const char *name;           /* for messages, "stdin" */
+    int flags;
+    int error;                  /* an error has been reported */
+    int regular;                /* a regular file, size is valid */
+    int compressed;             /* gzip input, read decompressed */
+    struct stat st;
+    uint64_t size;
+    uint64_t start;             /* position at the time of opening */
+    uint64_t offset;            /* position of the next block */
+#ifdef __unix__
+    int fd;
+    int own_fd;
+    struct gunzip *gz;          /* the decompressing thread */
+    unsigned char peek[2];      /* read to look for the gzip magic */
+    size_t peeked;
+#else
+    FILE *f;
+#endif
+    unsigned char *map;         /* the whole file, if mapped */
+    unsigned char *buffer;      /* blocks of reader_next() */
+    unsigned char *all;         /* data of reader_all(), if not mapped */
+    unsigned char *gathered;    /* data of reader_gather() */
+    size_t gathered_size;
+};
+
+/* A piece of the input for reader_gather(). */
+struct reader_range {
+    uint64_t offset;
+    size_t length;
+    const unsigned char *data;  /* set by reader_gather() */
+    size_t got;                 /* less than length at the end */
+};
+
+/* Prefix of the messages, set by main(). */
+extern const char *reader_progname;
+
+/* Nonzero if READER_GUNZIP has an effect, the reader was compiled with
+ * HAVE_ZLIB. */
+extern const int reader_gunzip;
+
+/* Opens the file, returns -1 if it can't be opened. */
+int reader_open(struct reader *r, const char *fname, int flags);
+
+/* Reads from the standard input. */
+void reader_stdin(struct reader *r, int flags);
+
+/* Makes *data point to the next block of the input and returns its
+ * length, 0 at the end or after an error. All blocks but the last have
+ * lengths which are multiples of 16 unless reader_seek() was given an
+ * offset which is not. */
+size_t reader_next(struct reader *r, const unsigned char **data);
+
+/* Continues at offset, input which can't seek is skipped up to it. */
+int reader_seek(struct reader *r, uint64_t offset);
+
+/* Continues at the position the input had when it was opened. */
+int reader_rewind(struct reader *r);
+
+/* Reads the ranges, which must be in ascending order if the input can't
+ * seek. The data is valid until the next call or reader_close(). The
+ * pieces of a regular file are read by several threads at once, so that
+ * the reads wait for the device together; a mapped file is asked for
+ * them all before the first is used. Returns -1 after an error. */
+int reader_gather(struct reader *r, struct reader_range *ranges, size_t n);
+
+/* The rest of the input in one piece, valid until reader_close(). */
+const unsigned char *reader_all(struct reader *r, size_t *size);
+
+void reader_close(struct reader *r);
+
+#endif
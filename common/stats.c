@@ -0,0 +1,151 @@
+/* File: stats.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* See stats.h. The read and write calls of the whole process come from
+ * /proc/self/io where there is one, else only the reads of the reader
+ * are known. "blocked" is the wall time the process was not on the
+ * CPU, mostly waiting for the disk; with a mapped file that is the only
+ * sign of I/O, besides the major page faults. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#include "stats.h"
+
+int stats_enabled = 0;
+
+static const char *stats_name;
+static int json;
+static double start;
+static unsigned long long bytes, lines, reads;
+static double read_time;
+
+double stats_clock(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+#else
+    return (double) time(NULL);
+#endif
+}
+
+void stats_data(const unsigned char *data, size_t n)
+{
+    const unsigned char *end = data + n;
+
+    bytes += n;
+    while ((data = memchr(data, '\n', end - data)) != NULL) {
+        ++lines;
+        ++data;
+    }
+}
+
+void stats_read(double seconds)
+{
+    ++reads;
+    read_time += seconds;
+}
+
+/* Reads a field like "syscr: 12" of /proc/self/io, -1 if unknown. */
+static long long proc_io(const char *text, const char *key)
+{
+    const char *p = text;
+    size_t n = strlen(key);
+
+    while (p && *p) {
+        if (strncmp(p, key, n) == 0 && p[n] == ':')
+            return atoll(p + n + 1);
+        if ((p = strchr(p, '\n')) != NULL)
+            ++p;
+    }
+    return -1;
+}
+
+static void report(void)
+{
+    char io[1024];
+    double wall = stats_clock() - start, user = 0, sys = 0, blocked;
+    long long read_calls = reads, write_calls = -1, storage = -1;
+    long max_rss = 0, minflt = 0, majflt = 0;
+    FILE *f;
+
+    fflush(stdout);
+#ifdef __unix__
+    {
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+            user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+            sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+            max_rss = ru.ru_maxrss;
+            minflt = ru.ru_minflt;
+            majflt = ru.ru_majflt;
+        }
+    }
+#else
+    user = (double) clock() / CLOCKS_PER_SEC;
+#endif
+    if ((f = fopen("/proc/self/io", "r")) != NULL) {
+        size_t n = fread(io, 1, sizeof(io) - 1, f);
+        io[n] = '\0';
+        fclose(f);
+        read_calls = proc_io(io, "syscr");
+        write_calls = proc_io(io, "syscw");
+        storage = proc_io(io, "read_bytes");
+    }
+    blocked = wall - user - sys;
+    if (blocked < 0)
+        blocked = 0;
+
+    if (json) {
+        fprintf(stderr, "{\"program\":\"%s\",\"wall\":%.6f,\"user\":%.6f,\"sys\":%.6f,"
+                "\"blocked\":%.6f,\"read_time\":%.6f,\"bytes\":%llu,\"lines\":%llu,"
+                "\"mb_per_s\":%.3f,\"read_calls\":%lld,\"write_calls\":%lld,"
+                "\"storage_read_bytes\":%lld,\"max_rss_kib\":%ld,"
+                "\"minor_faults\":%ld,\"major_faults\":%ld}\n",
+                stats_name, wall, user, sys, blocked, read_time, bytes, lines,
+                wall > 0 ? bytes / 1048576.0 / wall : 0.0, read_calls, write_calls,
+                storage, max_rss, minflt, majflt);
+        return;
+    }
+    fprintf(stderr, "%s: stats\n", stats_name);
+    fprintf(stderr, "  wall time     %10.3f s\n", wall);
+    fprintf(stderr, "  user time     %10.3f s\n", user);
+    fprintf(stderr, "  system time   %10.3f s\n", sys);
+    fprintf(stderr, "  blocked       %10.3f s  (%.0f%% of wall time off the CPU)\n",
+            blocked, wall > 0 ? 100 * blocked / wall : 0.0);
+    fprintf(stderr, "  in reads      %10.3f s\n", read_time);
+    fprintf(stderr, "  bytes         %10llu\n", bytes);
+    fprintf(stderr, "  lines         %10llu\n", lines);
+    fprintf(stderr, "  throughput    %10.1f MB/s\n", wall > 0 ? bytes / 1048576.0 / wall : 0.0);
+    fprintf(stderr, "  read calls    %10lld\n", read_calls);
+    if (write_calls >= 0)
+        fprintf(stderr, "  write calls   %10lld\n", write_calls);
+    if (storage >= 0)
+        fprintf(stderr, "  from storage  %10lld bytes\n", storage);
+    fprintf(stderr, "  peak RSS      %10.1f MiB\n", max_rss / 1024.0);
+    fprintf(stderr, "  page faults   %10ld minor, %ld major\n", minflt, majflt);
+}
+
+int stats_option(const char *arg, const char *name)
+{
+    if (strcmp(arg, "--stats") != 0 && strcmp(arg, "--stats=json") != 0)
+        return 0;
+    json = arg[7] == '=';
+    stats_name = name;
+    if (!stats_enabled) {
+        stats_enabled = 1;
+        start = stats_clock();
+        atexit(report);
+    }
+    return 1;
+}
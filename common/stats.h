@@ -0,0 +1,32 @@
+/* File: stats.h */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Option --stats of the tools using the reader: at the exit, a report of
+ * wall, user and system time, bytes and lines read, throughput, read and
+ * write calls, time spent in reads and blocked off the CPU, peak RSS and
+ * page faults is written to stderr, with --stats=json as one JSON object.
+ *
+ * Nothing is counted while the option is off, the reader tests
+ * stats_enabled once per block. */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+
+extern int stats_enabled;
+
+/* Returns 1 if arg is --stats or --stats=json and switches the report
+ * on, name is the program name in it. */
+int stats_option(const char *arg, const char *name);
+
+/* Used by the reader: a block of input handed out, and a read call
+ * which took the given number of seconds. */
+void stats_data(const unsigned char *data, size_t n);
+void stats_read(double seconds);
+
+/* Seconds of a monotonic clock. */
+double stats_clock(void);
+
+#endif
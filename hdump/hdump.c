@@ -1,41 +1,43 @@
 /* File: hdump.c */
 
-/* Version 1.01, Martin Titz, 1996, 1997, 2000 */
+/* Version 1.1, Martin Titz, 1996, 1997, 2000, 2026 */
 
+#include <ctype.h>
 #include <errno.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef BUFSIZ
-#if BUFSIZ>0 && BUFSIZ%16==0
-#define BUFFER_SIZE BUFSIZ
-#endif
-#endif
-
-#ifndef BUFFER_SIZE
-#define BUFFER_SIZE 4096
-#endif
-
-#if BUFFER_SIZE%16!=0
-#error BUFFER_SIZE must be a multiple of 16
-#endif
+#include "kernels.h"
+#include "reader.h"
+#include "stats.h"
 
 #define COL_HEX 12
 #define COL_ASC 63
 #define COLS    (COL_ASC + 16)
 
+#define PIECE   1048576         /* longest read of a range */
+#define PIECES  32              /* reads issued together */
+
+struct range {
+    unsigned long begin, end;   /* numbers of the first and last line */
+};
+
 static const unsigned char lc[16] = "0123456789abcdef";
 static const unsigned char uc[16] = "0123456789ABCDEF";
 static const unsigned char *hc  = lc;
 static int eightbit             = 0;
 static int error_count          = 0;
 static int verbose              = 0;
+static int read_flags           = READER_GUNZIP;
 static unsigned long begin      = 0;
 static unsigned long end        = ULONG_MAX;
 static unsigned char c          = '.';
-static unsigned char block[BUFFER_SIZE];
+static struct range *ranges     = NULL;
+static size_t range_count       = 0;
+static size_t range_max         = 0;
+static int ranges_merged        = 0;
 #ifdef __unix__
 static char *progname;
 #else
@@ -44,8 +46,9 @@ static const char *const progname = "hdump";
 
 static void usage(void)
 {
-    fprintf(stderr, "usage: %s [-b begin[bkm]] [-c char] [-e end[bkm]] [-l]"
-            " [-n count[bkm]] [-u]\n             [-v] [-7] [-8] [file]...\n",
+    fprintf(stderr, "usage: %s [-b begin[bkm]] [-c char] [-D] [-e end[bkm]] [-l]"
+            " [-n count[bkm]]\n             [-r ranges] [-R file] [-u] [-v] [-Z] [-7] [-8]"
+            " [--cpu=level]\n             [--stats[=json]] [file]...\n",
             progname);
 }
 
@@ -56,7 +59,8 @@ static void arg_err(char c)
     exit(EXIT_FAILURE);
 }
 
-static unsigned long get_ulong_mod16(const char *s)
+/* A number of bytes as a number of lines, *rest gets the end. */
+static unsigned long scan_mod16(const char *s, const char **rest)
 {
     unsigned long base, n;
     char ch;
@@ -98,12 +102,77 @@ static unsigned long get_ulong_mod16(const char *s)
         ++s;
     } else
         n >>= 4;
-    if (*s) {
-        fprintf(stderr, "%s: garbage after end of number.\n", progname);
-        usage();
+    *rest = s;
+    return n;
+}
+
+static void garbage(void)
+{
+    fprintf(stderr, "%s: garbage after end of number.\n", progname);
+    usage();
+    exit(EXIT_FAILURE);
+}
+
+static unsigned long get_ulong_mod16(const char *s)
+{
+    unsigned long n = scan_mod16(s, &s);
+    if (*s)
+        garbage();
+    return n;
+}
+
+/* Adds the ranges in list: begin-end, begin+count or begin alone for a
+   single line, separated by commas or white space. */
+static void add_ranges(const char *list)
+{
+    for (;;) {
+        struct range p;
+        unsigned long n;
+        while (*list == ',' || isspace((unsigned char)*list))
+            ++list;
+        if (!*list)
+            break;
+        p.begin = p.end = scan_mod16(list, &list);
+        if (*list == '-') {
+            p.end = scan_mod16(list+1, &list);
+        } else if (*list == '+') {
+            n = scan_mod16(list+1, &list);
+            p.end = n > 0 ? p.begin + n - 1 : p.begin;
+        }
+        if (*list && *list != ',' && !isspace((unsigned char)*list))
+            garbage();
+        if (p.end < p.begin) {
+            fprintf(stderr, "%s: range ends before it begins.\n", progname);
+            exit(EXIT_FAILURE);
+        }
+        if (range_count == range_max) {
+            range_max = range_max ? 2 * range_max : 64;
+            if ((ranges = realloc(ranges, range_max * sizeof(*ranges))) == NULL) {
+                fprintf(stderr, "%s: out of memory\n", progname);
+                exit(EXIT_FAILURE);
+            }
+        }
+        ranges[range_count++] = p;
+        ranges_merged = 0;
+    }
+}
+
+/* Adds the ranges listed in a file, '#' starts a comment. */
+static void read_ranges(const char *fname)
+{
+    FILE *f;
+    char line[1024], *t;
+
+    if ((f = fopen(fname, "r")) == NULL) {
+        fprintf(stderr, "%s: can't open %s (%s)\n", progname, fname, strerror(errno));
         exit(EXIT_FAILURE);
     }
-    return n;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (t = strchr(line, '#'))
+            *t = '\0';
+        add_ranges(line);
+    }
+    fclose(f);
 }
 
 static void tohex(unsigned long n, int digits, unsigned char *out)
@@ -114,67 +183,166 @@ static void tohex(unsigned long n, int digits, unsigned char *out)
     }
 }
 
-static void do_handle(FILE *f)
+/* Writes the lines of block, the first has the number *count. Returns 0
+   once the line after last is reached. */
+static int dump(const unsigned char *block, size_t bytes_read, unsigned long *count,
+                unsigned long last)
 {
-    size_t bytes_read, line;
-    unsigned long count;
+    size_t line;
     unsigned char s[COLS+1];
 
     memset(s, ' ', COLS);
     s[4] = ':';
     s[8] = '0';
     s[COLS] = '\0';
-    if (begin > 0 && fseek(f, begin << 4, SEEK_SET) != 0) {
-        fprintf(stderr, "%s: fseek error (%s)\n", progname, strerror(errno));
-        ++error_count;
+    for (line = 0; line < bytes_read; line += 16, ++*count) {
+        size_t i, end_pos;
+        unsigned char *t;
+        if (*count > last)
+            return 0;
+        if (bytes_read-line >= 16) {
+            kernels.hex_line(block+line, s+COL_HEX, s+COL_ASC, hc, c, eightbit);
+            end_pos = 0;
+        } else {
+            end_pos = bytes_read - line;
+            memset(s+COL_HEX, ' ', COLS-COL_HEX);
+        }
+        for (i = 0, t = s+COL_HEX; i < end_pos; ++i, t += 2) {
+            unsigned char b = block[line+i];
+            *t = hc[b >> 4];
+            *++t = hc[b & 0xf];
+            if (i == 7)
+                ++t;
+            s[COL_ASC+i] = b>=32 && b<127 || eightbit && b>=128 ? b : c;
+        }
+        tohex(*count >> 12,   4, s);
+        tohex(*count & 0xfff, 3, s+5);
+        puts((const char*)s);
+    }
+    return 1;
+}
+
+static int cmp_range(const void *a, const void *b)
+{
+    const struct range *x = a, *y = b;
+    return x->begin < y->begin ? -1 : x->begin > y->begin;
+}
+
+/* Sorts the ranges and joins those which overlap or adjoin. */
+static void merge_ranges(void)
+{
+    size_t i, n;
+
+    if (ranges_merged || range_count == 0)
         return;
+    qsort(ranges, range_count, sizeof(*ranges), cmp_range);
+    for (i = 1, n = 0; i < range_count; ++i) {
+        if (ranges[n].end == ULONG_MAX || ranges[i].begin <= ranges[n].end + 1) {
+            if (ranges[i].end > ranges[n].end)
+                ranges[n].end = ranges[i].end;
+        } else
+            ranges[++n] = ranges[i];
     }
-    for (count = begin; bytes_read = fread(block, 1, BUFFER_SIZE, f); ) {
-        for (line = 0; line < bytes_read; line += 16, ++count) {
-            size_t i, end_pos;
-            unsigned char *t;
-            if (count > end)
+    range_count = n + 1;
+    ranges_merged = 1;
+}
+
+static void range_header(const struct range *p, int first)
+{
+    unsigned char s[20];
+
+    memcpy(s, "0000:0000-0000:000f", 20);
+    tohex(p->begin >> 12,   4, s);
+    tohex(p->begin & 0xfff, 3, s+5);
+    tohex(p->end >> 12,     4, s+10);
+    tohex(p->end & 0xfff,   3, s+15);
+    if (!first)
+        puts("");
+    printf("Range %s:\n", (const char*)s);
+}
+
+/* Dumps the ranges. Their pieces are read PIECES at a time with
+   reader_gather(), so that the reads overlap. */
+static void do_ranges(struct reader *r)
+{
+    struct reader_range piece[PIECES];
+    size_t owner[PIECES];
+    size_t i = 0, k, n, shown = 0;
+    unsigned long line;
+
+    merge_ranges();
+    line = ranges[0].begin;
+    while (i < range_count) {
+        for (n = 0; n < PIECES && i < range_count; ++n) {
+            unsigned long left = ranges[i].end - line;
+            piece[n].offset = (uint64_t)line << 4;
+            piece[n].length = left < PIECE/16 ? (left + 1) * 16 : PIECE;
+            owner[n] = i;
+            if (left < PIECE/16) {
+                if (++i < range_count)
+                    line = ranges[i].begin;
+            } else
+                line += PIECE/16;
+        }
+        if (reader_gather(r, piece, n) != 0) {
+            ++error_count;
+            return;
+        }
+        for (k = 0; k < n; ++k) {
+            unsigned long count = piece[k].offset >> 4;
+            if (piece[k].got == 0)
                 return;
-            end_pos = 16;
-            if (bytes_read-line < 16) {
-                end_pos = bytes_read - line;
-                memset(s+COL_HEX, ' ', COLS-COL_HEX);
-            }
-            for (i = 0, t = s+COL_HEX; i < end_pos; ++i, t += 2) {
-                unsigned char b = block[line+i];
-                *t = hc[b >> 4];
-                *++t = hc[b & 0xf];
-                if (i == 7)
-                    ++t;
-                s[COL_ASC+i] = b>=32 && b<127 || eightbit && b>=128 ? b : c;
-            }
-            tohex(count >> 12,   4, s);
-            tohex(count & 0xfff, 3, s+5);
-            puts((const char*)s);
+            if (count == ranges[owner[k]].begin)
+                range_header(&ranges[owner[k]], shown++ == 0);
+            dump(piece[k].data, piece[k].got, &count, ULONG_MAX);
+            if (piece[k].got < piece[k].length)
+                return;         /* the end of the input */
         }
-        if (bytes_read < BUFFER_SIZE)
-            break;
     }
-    if (ferror(f)) {
-        fprintf(stderr, "%s: read error (%s)\n", progname, strerror(errno));
+}
+
+static void do_handle(struct reader *r)
+{
+    const unsigned char *block;
+    size_t bytes_read;
+    unsigned long count;
+
+    if (range_count > 0) {
+        do_ranges(r);
+        return;
+    }
+    if (begin > 0 && reader_seek(r, (unsigned long long)begin << 4) != 0) {
         ++error_count;
+        return;
     }
+    for (count = begin; bytes_read = reader_next(r, &block); )
+        if (!dump(block, bytes_read, &count, end))
+            return;
+    if (r->error)
+        ++error_count;
 }
 
 static void do_file(const char *fname)
 {
-    FILE *f;
+    struct reader r;
 
-    if ((f = fopen(fname, "rb")) == 0) {
-        fprintf(stderr, "%s: can't open %s (%s)\n",
-                progname, fname, strerror(errno));
+    if (reader_open(&r, fname, read_flags) != 0) {
         ++error_count;
         return;
     }
     if (verbose)
         printf("\nFile %s:\n\n", fname);
-    do_handle(f);
-    fclose(f);
+    do_handle(&r);
+    reader_close(&r);
+}
+
+static void do_stdin(void)
+{
+    struct reader r;
+
+    reader_stdin(&r, read_flags);
+    do_handle(&r);
+    reader_close(&r);
 }
 
 int main(int argc, char *argv[])
@@ -187,14 +355,18 @@ int main(int argc, char *argv[])
     if (ptmp = strrchr(progname, '/'))
         progname = ptmp + 1;
 #endif
+    reader_progname = progname;
+    kernels_level();
     for (--argc, ++argv;  argc > 0;  --argc, ++argv) {
         if (**argv == '-' && do_opts) {
+            if (stats_option(*argv, progname) || kernels_option(*argv, progname))
+                continue;
             if (argv[0][1] == 0) {
                 if (files_done)
                     puts("");
                 if (verbose)
                     puts("\nstdin:\n");
-                do_handle(stdin);
+                do_stdin();
                 ++files_done;
                 continue;
             }
@@ -212,6 +384,9 @@ int main(int argc, char *argv[])
                         if (*++*argv)
                             arg_err('c');
                         goto nextarg;
+                    case 'D':
+                        read_flags |= READER_DIRECT;
+                        break;
                     case 'e':
                         if (*++*argv || --argc && *++argv) {
                             end = get_ulong_mod16(*argv);
@@ -231,12 +406,27 @@ int main(int argc, char *argv[])
                         } else
                             arg_err('n');
                         goto nextarg;
+                    case 'r':
+                        if (*++*argv || --argc && *++argv) {
+                            add_ranges(*argv);
+                        } else
+                            arg_err('r');
+                        goto nextarg;
+                    case 'R':
+                        if (*++*argv || --argc && *++argv) {
+                            read_ranges(*argv);
+                        } else
+                            arg_err('R');
+                        goto nextarg;
                     case 'u':
                         hc = uc;
                         break;
                     case 'v':
                         ++verbose;
                         break;
+                    case 'Z':
+                        read_flags &= ~READER_GUNZIP;
+                        break;
                     case '7':
                         eightbit = 0;
                         break;
@@ -262,6 +452,6 @@ int main(int argc, char *argv[])
         nextarg: ;
     }
     if (!files_done)
-        do_handle(stdin);
+        do_stdin();
     return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
 }
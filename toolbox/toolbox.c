@@ -0,0 +1,260 @@
+/* File: toolbox.c */
+
+/* Version 1.0, Martin Titz, 2026 */
+
+/* Multi-call binary of the small tools: the tool is chosen by the name
+ * it is called with, as the tools derive their progname from argv[0]
+ * anyway, so a symbolic link hdump -> toolbox runs hdump. Called as
+ * toolbox, the first argument names the tool.
+ *
+ * toolbox --batch reads command lines from stdin and runs them one after
+ * the other, without an exec or dynamic loading for each. Words are
+ * separated by blanks and may be quoted with '...' or "...", a backslash
+ * quotes the next character. An unquoted < or > followed by a file, with
+ * or without blanks between, redirects stdin or stdout of the command,
+ * stdin is /dev/null otherwise. Lines starting with # are ignored. The
+ * tools keep their options in static variables and leave with exit(),
+ * so every command runs in a forked child of the batch process. The exit
+ * status is 1 if a command failed. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_LINE 65536
+#define MAX_ARGS 1024
+
+int charstat_main(int argc, char *argv[]);
+int contains_main(int argc, char *argv[]);
+int hdump_main(int argc, char *argv[]);
+int joinlines_main(int argc, char *argv[]);
+int linelengths_main(int argc, char *argv[]);
+int textprof_main(int argc, char *argv[]);
+int tm_main(int argc, char *argv[]);
+int winsize_main(int argc, char *argv[]);
+
+struct tool {
+    const char *name;
+    int (*main)(int argc, char *argv[]);
+};
+
+static const struct tool tools[] = {
+    {"charstat",    charstat_main},
+    {"contains",    contains_main},
+    {"hdump",       hdump_main},
+    {"joinlines",   joinlines_main},
+    {"linelengths", linelengths_main},
+    {"textprof",    textprof_main},
+    {"tm",          tm_main},
+    {"winsize",     winsize_main},
+};
+#define TOOLS (sizeof(tools) / sizeof(tools[0]))
+
+static int error_count = 0;
+static char *progname;
+
+static void usage(void)
+{
+    size_t i;
+
+    fprintf(stderr, "usage: %s tool [argument]...\n"
+                    "       %s --batch < commands\n"
+                    "       %s --list\n", progname, progname, progname);
+    fprintf(stderr, "tools:");
+    for (i = 0; i < TOOLS; ++i)
+        fprintf(stderr, " %s", tools[i].name);
+    fprintf(stderr, "\n");
+}
+
+static const struct tool *find_tool(const char *name)
+{
+    const char *p;
+    size_t i;
+
+    if ((p = strrchr(name, '/')))
+        name = p + 1;
+    for (i = 0; i < TOOLS; ++i) {
+        if (strcmp(name, tools[i].name) == 0)
+            return &tools[i];
+    }
+    return NULL;
+}
+
+/* Splits line in place into words, a word after '<' or '>' is the file
+   to redirect. Returns the number of words, -1 on an unterminated quote
+   or too many words, -2 on a redirection without a file. */
+static int split_line(char *line, char *argv[], char **in, char **out)
+{
+    char *s = line, *d;
+    int argc = 0;
+
+    *in = *out = NULL;
+    for (;;) {
+        char *word, quote = 0;
+        int redirect = 0;
+        while (*s == ' ' || *s == '\t')
+            ++s;
+        if (*s == '\0' || *s == '\n')
+            break;
+        if (*s == '<' || *s == '>') {
+            redirect = *s++;
+            while (*s == ' ' || *s == '\t')
+                ++s;
+            if (*s == '\0' || *s == '\n' || *s == '<' || *s == '>')
+                return -2;
+        }
+        word = d = s;
+        while (*s && (quote || (*s != ' ' && *s != '\t' && *s != '\n'))) {
+            if (quote && *s == quote) {
+                quote = 0;
+                ++s;
+            } else if (!quote && (*s == '\'' || *s == '"')) {
+                quote = *s++;
+            } else if (*s == '\\' && quote != '\'' && s[1] && s[1] != '\n') {
+                *d++ = s[1];
+                s += 2;
+            } else {
+                *d++ = *s++;
+            }
+        }
+        if (quote)
+            return -1;
+        if (*s)
+            ++s;
+        *d = '\0';
+        if (redirect == '<')
+            *in = word;
+        else if (redirect == '>')
+            *out = word;
+        else if (argc == MAX_ARGS - 1)
+            return -1;
+        else
+            argv[argc++] = word;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/* Runs one command in a child, returns its exit status. */
+static int run_command(const struct tool *t, int argc, char *argv[],
+                       const char *in, const char *out)
+{
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    if ((pid = fork()) < 0) {
+        fprintf(stderr, "%s: can't fork (%s)\n", progname, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        int fd = open(in ? in : "/dev/null", O_RDONLY);
+        if (fd < 0 || dup2(fd, STDIN_FILENO) < 0) {
+            fprintf(stderr, "%s: can't open %s (%s)\n", argv[0], in, strerror(errno));
+            _exit(EXIT_FAILURE);
+        }
+        close(fd);
+        if (out) {
+            if ((fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0
+                || dup2(fd, STDOUT_FILENO) < 0) {
+                fprintf(stderr, "%s: can't create %s (%s)\n", argv[0], out, strerror(errno));
+                _exit(EXIT_FAILURE);
+            }
+            close(fd);
+        }
+        exit(t->main(argc, argv));
+    }
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "%s: wait failed (%s)\n", progname, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "%s: %s killed by signal %d\n", progname, argv[0], WTERMSIG(status));
+        return EXIT_FAILURE;
+    }
+    return WEXITSTATUS(status);
+}
+
+static void batch(void)
+{
+    static char line[MAX_LINE];
+    char *argv[MAX_ARGS], *in, *out;
+    const struct tool *t;
+    unsigned long lineno = 0;
+    int argc;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        ++lineno;
+        if (strchr(line, '\n') == NULL && !feof(stdin)) {
+            fprintf(stderr, "%s: line %lu too long\n", progname, lineno);
+            ++error_count;
+            while (fgets(line, sizeof(line), stdin) && strchr(line, '\n') == NULL)
+                ;
+            continue;
+        }
+        if (line[strspn(line, " \t")] == '#')
+            continue;
+        if ((argc = split_line(line, argv, &in, &out)) < 0) {
+            fprintf(stderr, argc == -2 ? "%s: line %lu: redirection without a file\n"
+                                       : "%s: line %lu: unterminated quote or too many words\n",
+                    progname, lineno);
+            ++error_count;
+            continue;
+        }
+        if (argc == 0 || argv[0][0] == '#')
+            continue;
+        if ((t = find_tool(argv[0])) == NULL) {
+            fprintf(stderr, "%s: line %lu: unknown tool %s\n", progname, lineno, argv[0]);
+            ++error_count;
+            continue;
+        }
+        if (run_command(t, argc, argv, in, out) != 0)
+            ++error_count;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const struct tool *t;
+    char *ptmp;
+    size_t i;
+
+    progname = argv[0];
+    if ((ptmp = strrchr(progname, '/')))
+        progname = ptmp + 1;
+
+    if ((t = find_tool(argv[0])) != NULL)
+        return t->main(argc, argv);
+
+    if (argc < 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (strcmp(argv[1], "--batch") == 0 && argc == 2) {
+        batch();
+        return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    if (strcmp(argv[1], "--list") == 0 && argc == 2) {
+        for (i = 0; i < TOOLS; ++i)
+            printf("%s\n", tools[i].name);
+        return EXIT_SUCCESS;
+    }
+    if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        usage();
+        return EXIT_SUCCESS;
+    }
+    if ((t = find_tool(argv[1])) == NULL) {
+        fprintf(stderr, "%s: unknown tool %s\n", progname, argv[1]);
+        usage();
+        return EXIT_FAILURE;
+    }
+    return t->main(argc - 1, argv + 1);
+}